@@ -25,7 +25,7 @@ static constexpr const char* cHttpHeader =
 	"Connection: Close\r\n"
 	"User-Agent: ArduinoIoT/1.0\r\n";
 
-void AprsWebClient::GenerateWeatherReportPacket(const time_t now, unsigned char humidity, const short temperature, unsigned char battery)
+void AprsWebClient::GenerateWeatherReportPacket(const time_t now, const char* objectName, unsigned char humidity, const short temperature, unsigned char battery)
 {
 	if (humidity >= 100)
 	{
@@ -42,7 +42,15 @@ void AprsWebClient::GenerateWeatherReportPacket(const time_t now, unsigned char
 	
 	float fahrenheit = round(static_cast<float>(temperature) * static_cast<float>(0.18) + static_cast<float>(32.0));
 	
-	snprintf(mAprsPacket, cAprsPacketSize, APRS_CALLSIGN ">APRS,TCPIP*:@%6sz" APRS_LATITUDE "/" ARPS_LONGITUDE "_c...s...g...t%03.0fh%02u Bat: %u%%" USER_COMMENT "\n", timestamp, fahrenheit, humidity, battery);
+	if (objectName)
+	{
+		// Object at the station position, name padded to 9 characters
+		snprintf(mAprsPacket, cAprsPacketSize, APRS_CALLSIGN ">APRS,TCPIP*:;%-9.9s*%6sz" APRS_LATITUDE "/" ARPS_LONGITUDE "_c...s...g...t%03.0fh%02u Bat: %u%%" USER_COMMENT "\n", objectName, timestamp, fahrenheit, humidity, battery);
+	}
+	else
+	{
+		snprintf(mAprsPacket, cAprsPacketSize, APRS_CALLSIGN ">APRS,TCPIP*:@%6sz" APRS_LATITUDE "/" ARPS_LONGITUDE "_c...s...g...t%03.0fh%02u Bat: %u%%" USER_COMMENT "\n", timestamp, fahrenheit, humidity, battery);
+	}
 }
 
 void AprsWebClient::UpdateContentLengthHeader()
@@ -75,10 +83,11 @@ bool AprsWebClient::Connect()
 	return true;
 }
 
+/// <param name="objectName">APRS object (max. 9 characters), nullptr: weather report of this station</param>
 /// <param name="humidity">[%] valid range: 0..99</param>
 /// <param name="temperature">[0.1°C]</param>
 /// <param name="battery">[%] (sent as comment)</param>
-bool AprsWebClient::SendWeatherReportPacket(unsigned char humidity, const short temperature, unsigned char battery)
+bool AprsWebClient::SendWeatherReportPacket(const char* objectName, unsigned char humidity, const short temperature, unsigned char battery)
 {
 	if (sizeof(APRS_LATITUDE) != sizeof("0000.00N") || sizeof(ARPS_LONGITUDE) != sizeof("00000.00E"))
 	{
@@ -87,15 +96,9 @@ bool AprsWebClient::SendWeatherReportPacket(unsigned char humidity, const short
 	}
 
 	const auto now = NtpRtc::instance()->GetTime();
-	if (difftime(now, mLastSendTime) < minAprsSendingInterval)
-	{
-		DebugTRACE("Do not send APRS packet due to time restriction!\n");
-		return false;
-	}
-	mLastSendTime = now;
 
 	DebugTRACE("Generating weather report packet...\n");
-	GenerateWeatherReportPacket(now, humidity, temperature, battery);
+	GenerateWeatherReportPacket(now, objectName, humidity, temperature, battery);
 	UpdateContentLengthHeader(); // Update mandatory length header before sending
 	
 	if (!Connect())
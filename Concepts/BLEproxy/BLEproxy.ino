@@ -1,14 +1,18 @@
 #include "credentials.h" 
 #include "deviceconfig.h"
 #include "AprsWebClient.h"
-#include "BleAdvertisementParser.h"
+#include "BleScanScheduler.h"
+#include "BleSensorTable.h"
 #include "WiFiManager.h"
 #include "NtpRtc.h"
+#include "RadioCoexistence.h"
 #include <ArduinoBLE.h>
 
 
 AprsWebClient aprsClient;
-BleAdvertisementParser bleParser;
+BleSensorTable sensorTable;
+BleScanScheduler scanScheduler(sensorTable);
+RadioCoexistence radioCoexistence(sensorTable, scanScheduler, aprsClient);
 
 
 void setup()
@@ -32,39 +36,41 @@ void setup()
 	WiFiManager::Disconnect();
 	UserLED(OFF);
 
+	DebugTRACE("Sensors: "); DebugPRINTLN(sensorTable.GetCount());
+
 	if (!BLE.begin())
 	{
 		DebugTRACE("Starting BLE failed!\n");
 		error();
 	}	
-	BLE.scanForAddress(SHELLY_BLUHT_ADDRESS);
+	// Scanning is started by scanScheduler
 }
 
 
 void loop()
 {
+	scanScheduler.Update();
+
 	BLEDevice peripheral = BLE.available();
 	if (peripheral && peripheral.hasAdvertisementData())
 	{
-		if (bleParser.FetchBleData(peripheral))
+		// Everything in range is reported, only configured sensors are parsed
+		BleSensor* sensor = sensorTable.Find(peripheral);
+		if (sensor && sensor->parser.FetchBleData(peripheral))
 		{
-			BLE.stopScan();
-			BLE.end();
-
-			aprsClient.SendWeatherReportPacket(
-				bleParser.GetHumidity(),
-				bleParser.GetTemperature(),
-				bleParser.GetBatteryLevel()
-			);
-
-			if (!BLE.begin())
+			sensor->predictor.OnPacket(millis());
+			if (sensor->IsSendingDue(NtpRtc::instance()->GetTime()))
 			{
-				DebugTRACE("Starting BLE failed!\n");
-				error();
-			}	
-			BLE.scanForAddress(SHELLY_BLUHT_ADDRESS);
+				radioCoexistence.QueueUpload(*sensor);
+			}
 		}
 	}
+
+	if (!radioCoexistence.Update())
+	{
+		DebugTRACE("Starting BLE failed!\n");
+		error();
+	}
 }
 
 
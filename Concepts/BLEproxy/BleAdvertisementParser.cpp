@@ -2,58 +2,86 @@
 #include "deviceconfig.h"
 #include <string.h>
 
-BleAdvertisementParser::BleAdvertisementParser()
-	: mPacketId(0)
-	, mBatteryLevel(0)
-	, mHumidity(0)
-	, mTemperature(0)
-	, mButtonPressed(false)
+BleAdvertisementParser::BleAdvertisementParser(ClockFunction clock)
+	: mClock(clock)
+	, mData()
 	, mParseError(false)
 	, mLastSuccess(0)
 	, mLastPacketId(0)
+	, mAdvertisementData()
+	, mAddress()
+	, mCrypto()
 {
 }
 
+bool BleAdvertisementParser::SetBindKey(const unsigned char address[6], const char* hexKey)
+{
+	memcpy(mAddress, address, sizeof(mAddress));
+	return mCrypto.SetKey(hexKey);
+}
+
+time_t BleAdvertisementParser::DefaultClock()
+{
+#ifdef ARDUINO
+	return NtpRtc::instance()->GetTime();
+#else
+	return time(nullptr);
+#endif
+}
+
+#ifdef ARDUINO
 bool BleAdvertisementParser::FetchBleData(BLEDevice& device)
 {
-	uint8_t advertisementDataLength = device.advertisementDataLength();
-	DebugTRACE("Received "); DebugPRINT(advertisementDataLength); DebugPRINTLN(" Bytes");
-	if (!advertisementDataLength)
+	int advertisementDataLength = device.advertisementDataLength();
+	if (advertisementDataLength <= 0 || advertisementDataLength > maxAdvertisementDataLength)
 	{
+		DebugTRACE("Invalid length "); DebugPRINTLN(advertisementDataLength);
 		return false;
 	}
 
-	uint8_t* pAdvertisementData = (uint8_t*)malloc(advertisementDataLength);
-	if (!pAdvertisementData)
+	// Copied once into the member buffer, parsed in place from there
+	advertisementDataLength = device.advertisementData(mAdvertisementData, advertisementDataLength);
+
+#ifdef _DEBUG_TRACE_RAW_
+	DebugTRACE("Received "); DebugPRINT(advertisementDataLength); DebugPRINT(" Bytes:");
+	for (int i = 0; i < advertisementDataLength; i++)
 	{
-		DebugTRACE("Out of memory!\n");
-		return false;
+		DebugPRINT(mAdvertisementData[i] < 0x10 ? " 0" : " ");
+		DebugPRINT(mAdvertisementData[i], HEX);
 	}
-	
-	device.advertisementData(pAdvertisementData, advertisementDataLength);
+	DebugPRINTLN();
+#endif
+
+	return FetchBleData(mAdvertisementData, advertisementDataLength);
+}
+#endif
 
-	// Print raw data
-	for (uint8_t i = 0; i < advertisementDataLength; i++)
+bool BleAdvertisementParser::FetchBleData(const unsigned char* data, const int dataLength)
+{
+	if (dataLength <= 0 || dataLength > maxAdvertisementDataLength)
 	{
-		DebugPRINT(pAdvertisementData[i] < 0x10 ? " 0" : " ");
-		DebugPRINT(pAdvertisementData[i], HEX);
+		DebugTRACE("Invalid length "); DebugPRINTLN(dataLength);
+		return false;
 	}
-	DebugPRINTLN();
 
-	ParseAdvertisementData(pAdvertisementData, advertisementDataLength);
-	free(pAdvertisementData);
+	// A rejected (e.g. replayed or truncated) packet leaves mData untouched and must not count as new data
+	mLastPacketId = mData.packetId;
+	mParseError = false;
+
+	ParseAdvertisementData(data, dataLength);
 
 	return IsDataValid();
 }
 
 bool BleAdvertisementParser::IsDataValid() const
 {
-	const bool differentPackets = (mPacketId != mLastPacketId);
-	const bool dataAgeCheck = (difftime(NtpRtc::instance()->GetTime(), mLastSuccess) < maxDataAge);
+	const bool differentPackets = (mData.packetId != mLastPacketId);
+	const bool dataAgeCheck = (difftime(mClock(), mLastSuccess) < maxDataAge);
 	
 	DebugTRACE("Packets differ: "); DebugPRINT(TOBOOL(differentPackets)); DebugPRINT(" && Data age check: "); DebugPRINTLN(TOBOOL(dataAgeCheck));
+	DebugTRACE("Parse error: "); DebugPRINTLN(TOBOOL(mParseError));
 
-	return differentPackets && dataAgeCheck;
+	return differentPackets && dataAgeCheck && !mParseError;
 }
 
 void BleAdvertisementParser::ParseAdvertisementData(const unsigned char* pData, unsigned char dataLen)
@@ -93,23 +121,45 @@ void BleAdvertisementParser::ParseAdvertisingDataElement(const unsigned char* co
 
 void BleAdvertisementParser::ParseServiceDataElement(const unsigned char* pData, unsigned char dataLen)
 {
-	if (dataLen < 5 || !IsBtHomeUuid(&pData[0], dataLen) || !IsUnencryptedBtHomeVersion2(pData[2]))
+	if (dataLen < 5 || !IsBtHomeUuid(&pData[0], dataLen) || !IsBtHomeVersion2(pData[2]))
 	{
 		return;
 	}
-	pData += (2 + 1);
-	dataLen -= (2 + 1);
-
-	mPacketId = 0;
-	mBatteryLevel = 0;
-	mHumidity = 0;
-	mTemperature = 0;
-	mButtonPressed = false;
-	mParseError = false;
 
+	unsigned char plainData[maxAdvertisementDataLength];
+	if (IsEncrypted(pData[2]) != mCrypto.IsEnabled())
+	{
+		DebugTRACE("Encryption mismatch, packet ignored\n");
+		return;
+	}
+	else if (mCrypto.IsEnabled())
+	{
+		// UUID, device info, encrypted data, counter, MIC
+		const unsigned char overheadLen = (2 + 1) + BtHomeCrypto::counterLength + BtHomeCrypto::micLength;
+		if (dataLen <= overheadLen)
+		{
+			return;
+		}
+		const unsigned char encryptedDataLen = dataLen - overheadLen;
+		if (!mCrypto.Decrypt(mAddress, pData, &pData[2 + 1], encryptedDataLen, &pData[2 + 1 + encryptedDataLen], plainData))
+		{
+			DebugTRACE("Not authentic or replayed, packet ignored\n");
+			return;
+		}
+		pData = plainData;
+		dataLen = encryptedDataLen;
+	}
+	else
+	{
+		pData += (2 + 1);
+		dataLen -= (2 + 1);
+	}
+
+	// Decoded into a copy, the values of a packet with an error are not used at all
+	BtHomeData data = BtHomeData();
 	while (dataLen)
 	{
-		char consumedDataLen = ParseServiceItem(pData, dataLen);
+		char consumedDataLen = ParseServiceItem(pData, dataLen, data);
 		if (consumedDataLen == 0)
 		{
 			return;
@@ -118,10 +168,8 @@ void BleAdvertisementParser::ParseServiceDataElement(const unsigned char* pData,
 		dataLen -= consumedDataLen;
 	}
 
-	if (!mParseError)
-	{
-		mLastSuccess = NtpRtc::instance()->GetTime();
-	}
+	mData = data;
+	mLastSuccess = mClock();
 }
 
 bool BleAdvertisementParser::IsBtHomeUuid(const unsigned char* const data, const unsigned char dataLen) const
@@ -130,100 +178,86 @@ bool BleAdvertisementParser::IsBtHomeUuid(const unsigned char* const data, const
 	return (dataLen >= 2) && (memcmp(data, btHomeUuid, sizeof(btHomeUuid)) == 0);
 }
 
-bool BleAdvertisementParser::IsUnencryptedBtHomeVersion2(const unsigned char flags) const
+bool BleAdvertisementParser::IsBtHomeVersion2(const unsigned char flags) const
 {
-	const unsigned char encryptionFlagBit = (1 << 0);
 	const unsigned char btHomeVersionBits = (7 << 5);
 	const unsigned char btHomeVersion2 = (2 << 5);
-	return ((flags & (btHomeVersionBits | encryptionFlagBit)) == btHomeVersion2);
+	return ((flags & btHomeVersionBits) == btHomeVersion2);
 }
 
-unsigned char BleAdvertisementParser::ParseServiceItem(const unsigned char* const data, const unsigned char availableDataLen)
+bool BleAdvertisementParser::IsEncrypted(const unsigned char flags) const
 {
-	unsigned char consumedDataLen = 0;
-	const unsigned char itemtype = data[0];
-	switch (itemtype)
-	{
-	case 0x00:  // Packet ID
-		if (availableDataLen >= 2)
-		{
-			mLastPacketId = mPacketId;
-			mPacketId = data[1];
-			consumedDataLen = 2;
-		}
-		break;
-
-	case 0x01:  // Battery level
-		if (availableDataLen >= 2)
-		{
-			mBatteryLevel = data[1];
-			consumedDataLen = 2;
-		}
-		break;
-
-	case 0x2E:  // Humidity
-		if (availableDataLen >= 2)
-		{
-			mHumidity = data[1];
-			consumedDataLen = 2;
-		}
-		break;
+	const unsigned char encryptionFlagBit = (1 << 0);
+	return (flags & encryptionFlagBit) != 0;
+}
 
-	case 0x45:  // Temperature
-		if (availableDataLen >= 3)
-		{
-			memcpy((void*)&mTemperature, &data[1], 2);
-			consumedDataLen = 3;
-		}
-		break;
+unsigned char BleAdvertisementParser::ParseServiceItem(const unsigned char* const data, const unsigned char availableDataLen, BtHomeData& decodedData)
+{
+	const BtHomeObject* const object = BtHomeObjects::Find(data[0]);
+	if (!object)
+	{
+		DebugTRACE("Unknown object ID "); DebugPRINTLN(data[0], HEX);
+		mParseError = true;	// Error at this point since we cannot continue parsing the remaining data!
+		return 0;
+	}
 
-	case 0x3A:  // Button event
-		if (availableDataLen >= 2)
-		{
-			mButtonPressed = data[1] == 0x01;
-			consumedDataLen = 2;
-		}
-		break;
+	// Object ID [, length], payload
+	unsigned char headerLen = 1;
+	unsigned char payloadLen = object->length;
+	if (payloadLen == BtHomeObjects::variableLength)
+	{
+		headerLen = 2;
+		payloadLen = (availableDataLen >= headerLen) ? data[1] : 0;
+	}
 
-	default:	// Unknown
-		mParseError = true;	// Error at this point since we cannot continue parsing the remaining data!
+	if (availableDataLen < headerLen || availableDataLen - headerLen < payloadLen)
+	{
+		mParseError = true;	// Item truncated
 		return 0;
 	}
 
-	return consumedDataLen;
+	// Objects not of our interest are skipped
+	BtHomeObjects::Decode(*object, &data[headerLen], decodedData);
+
+	return headerLen + payloadLen;
 }
 
 unsigned char BleAdvertisementParser::GetPacketId() const
 {
-	DebugTRACE("PacketID: "); DebugPRINTLN(mPacketId);
-	return mPacketId;
+	DebugTRACE("PacketID: "); DebugPRINTLN(mData.packetId);
+	return mData.packetId;
 }
 
 unsigned char BleAdvertisementParser::GetBatteryLevel() const
 {
-	DebugTRACE("Battery: "); DebugPRINTLN(mBatteryLevel);
-	return mBatteryLevel;
+	DebugTRACE("Battery: "); DebugPRINTLN(mData.batteryLevel);
+	return mData.batteryLevel;
 }
 
 unsigned char BleAdvertisementParser::GetHumidity() const
 {
-	DebugTRACE("Humidty: "); DebugPRINTLN(mHumidity);
-	return mHumidity;
+	DebugTRACE("Humidty: "); DebugPRINTLN(mData.humidity);
+	return mData.humidity;
 }
 
 short BleAdvertisementParser::GetTemperature() const
 {
-	DebugTRACE("Temperature: "); DebugPRINTLN(mTemperature);
-	return mTemperature;
+	DebugTRACE("Temperature: "); DebugPRINTLN(mData.temperature);
+	return mData.temperature;
 }
 
 bool BleAdvertisementParser::GetButtonPressed() const
 {
-	DebugTRACE("Button pressed: "); DebugPRINTLN(TOBOOL(mButtonPressed));
-	return mButtonPressed;
+	DebugTRACE("Button pressed: "); DebugPRINTLN(mData.buttonEvent);
+	return mData.buttonEvent == 0x01;
 }
 
 bool BleAdvertisementParser::HasParseError() const
 {
 	return mParseError;
 }
+
+const BtHomeData& BleAdvertisementParser::GetData() const
+{
+	return mData;
+}
@@ -1,17 +1,40 @@
 #pragma once
 
+/*
+ * Besides the Arduino build, parser and BTHome decoding build on the host without NtpRtc / ArduinoBLE
+ * (ARDUINO not defined, clock injected, raw advertising data as input), e.g. to feed recorded or malformed packets:
+ * g++ -std=c++17 -Wall -c BleAdvertisementParser.cpp BtHomeObjects.cpp BtHomeCrypto.cpp
+ */
+
+#include "BtHomeCrypto.h"
+#include "BtHomeObjects.h"
+#include <ctime>
+#ifdef ARDUINO
 #include "NtpRtc.h"
 #include <ArduinoBLE.h>
+#endif
 
 class BleAdvertisementParser
 {
 	/// @brief Time in [s] of which the last BLE packet is considered valid
 	static constexpr auto maxDataAge =	(5 * 60);
+	/// @brief Max. advertising data length of legacy advertising PDUs (extended advertising would be 255, not supported by the NINA firmware)
+	static constexpr auto maxAdvertisementDataLength =	31;
 
 public:
-	BleAdvertisementParser();
+	/// @brief Time source in [s] for the data age check
+	typedef time_t (*ClockFunction)();
+
+	explicit BleAdvertisementParser(ClockFunction clock = DefaultClock);
 
+	/// @brief Accept only encrypted packets of this device, hexKey: bind key (32 hex digits), nullptr: accept only unencrypted packets
+	bool SetBindKey(const unsigned char address[6], const char* hexKey);
+#ifdef ARDUINO
 	bool FetchBleData(BLEDevice& device);
+#endif
+	/// @brief Parse the raw advertising data (length-prefixed AD structures), true if it carried new valid data
+	bool FetchBleData(const unsigned char* data, const int dataLength);
+	/// @brief New data of the last packet, false if it could not be parsed completely (GetData() still holds the previous packet)
 	bool IsDataValid() const;
 
 	unsigned char GetPacketId() const;
@@ -20,22 +43,26 @@ public:
 	short GetTemperature() const;
 	bool GetButtonPressed() const;
 	bool HasParseError() const;
+	const BtHomeData& GetData() const;
 
 private:
+	/// @brief NtpRtc time on the device, system time on the host
+	static time_t DefaultClock();
 	void ParseAdvertisementData(const unsigned char* pData, unsigned char dataLen);
 	void ParseAdvertisingDataElement(const unsigned char* const data, const unsigned char elementLen);
 	void ParseServiceDataElement(const unsigned char* pData, unsigned char dataLen);
 	bool IsBtHomeUuid(const unsigned char* const data, const unsigned char dataLen) const;
-	bool IsUnencryptedBtHomeVersion2(const unsigned char flags) const;
-	unsigned char ParseServiceItem(const unsigned char* const data, const unsigned char availableDataLen);
-
-	unsigned char mPacketId;		// [ 0..255 ]
-	unsigned char mBatteryLevel;	// [ % ]
-	unsigned char mHumidity;		// [ % ]
-	short mTemperature;				// [ 0.1 °C ]
-	bool mButtonPressed;
+	bool IsBtHomeVersion2(const unsigned char flags) const;
+	bool IsEncrypted(const unsigned char flags) const;
+	unsigned char ParseServiceItem(const unsigned char* const data, const unsigned char availableDataLen, BtHomeData& decodedData);
+
+	ClockFunction mClock;
+	BtHomeData mData;
 	bool mParseError;
 	time_t mLastSuccess;
 	unsigned char mLastPacketId;
+	unsigned char mAdvertisementData[maxAdvertisementDataLength];
+	unsigned char mAddress[6];
+	BtHomeCrypto mCrypto;
 };
 
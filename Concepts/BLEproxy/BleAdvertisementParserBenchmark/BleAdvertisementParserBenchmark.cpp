@@ -0,0 +1,92 @@
+/*
+ * BleAdvertisementParserBenchmark.cpp
+ *
+ * Host throughput of BleAdvertisementParser on raw advertising data, in advertisements per second (google-benchmark).
+ * Build: g++ -std=c++17 -O2 -I.. -o BleAdvertisementParserBenchmark BleAdvertisementParserBenchmark.cpp ../BleAdvertisementParser.cpp ../BtHomeObjects.cpp ../BtHomeCrypto.cpp -lbenchmark -lpthread
+ * Usage: BleAdvertisementParserBenchmark [--benchmark_filter=...]
+ *
+ * Input is a Shelly BLU H&T packet (see ../../BLEreceiver/shelly_bluht_ble_format.txt), plain and encrypted,
+ * an advertisement of another device (iBeacon) and a truncated packet.
+ */ 
+
+#include <cstring>
+#include <benchmark/benchmark.h>
+
+#include "BleAdvertisementParser.h"
+
+static const unsigned char address[6] =	{ 0x7C, 0xC6, 0xB6, 0x61, 0xE3, 0xA0 };
+static const char bindKey[] =				"231d39c1d7cc1ab1aee224cd096db932";
+
+static const unsigned char shellyPlain[] =		{ 0x02, 0x01, 0x06, 0x0F, 0x16, 0xD2, 0xFC, 0x44, 0x00, 0x30, 0x01, 0x64, 0x2E, 0x24, 0x3A, 0x01, 0x45, 0xF4, 0x00 };
+static const unsigned char shellyEncrypted[] =	{ 0x02, 0x01, 0x06, 0x15, 0x16, 0xD2, 0xFC, 0x45, 0x3F, 0xD7, 0x8A, 0xE5, 0xEF, 0x24, 0x9A, 0x2D, 0xD1,
+												  0x05, 0x01, 0x00, 0x00, 0xCC, 0x43, 0x4C, 0xEC };
+static const unsigned char iBeacon[] =			{ 0x02, 0x01, 0x06, 0x1A, 0xFF, 0x4C, 0x00, 0x02, 0x15, 0xE2, 0xC5, 0x6D, 0xB5, 0xDF, 0xFB, 0x48, 0xD2,
+												  0xB0, 0x60, 0xD0, 0xF5, 0xA7, 0x10, 0x96, 0xE0, 0x00, 0x01, 0x00, 0x02, 0xC5 };
+static const unsigned char shellyTruncated[] =	{ 0x02, 0x01, 0x06, 0x0A, 0x16, 0xD2, 0xFC, 0x44, 0x00, 0x30, 0x01, 0x64, 0x45, 0xF4 };
+
+
+static time_t Clock()
+{
+	return 1000;
+}
+
+
+static void BM_Plain(benchmark::State& state)
+{
+	BleAdvertisementParser parser(Clock);
+	unsigned char data[sizeof(shellyPlain)];
+	memcpy(data, shellyPlain, sizeof(data));
+
+	for (auto _ : state)
+	{
+		data[9]++;	// Packet id, a new packet each time
+		if (!parser.FetchBleData(data, sizeof(data)))
+		{
+			state.SkipWithError("Packet not accepted");
+			return;
+		}
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Plain);
+
+
+static void BM_Encrypted(benchmark::State& state)
+{
+	BleAdvertisementParser keyed(Clock);
+	keyed.SetBindKey(address, bindKey);
+
+	for (auto _ : state)
+	{
+		BleAdvertisementParser parser = keyed;	// The counter of a packet is accepted only once
+		if (!parser.FetchBleData(shellyEncrypted, sizeof(shellyEncrypted)))
+		{
+			state.SkipWithError("Packet not accepted");
+			return;
+		}
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Encrypted);
+
+
+template <const unsigned char* Data, int Length>
+static void BM_Ignored(benchmark::State& state)
+{
+	BleAdvertisementParser parser(Clock);
+
+	for (auto _ : state)
+	{
+		if (parser.FetchBleData(Data, Length))
+		{
+			state.SkipWithError("Packet accepted");
+			return;
+		}
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_Ignored, iBeacon, sizeof(iBeacon));
+BENCHMARK_TEMPLATE(BM_Ignored, shellyTruncated, sizeof(shellyTruncated));
+
+
+BENCHMARK_MAIN();
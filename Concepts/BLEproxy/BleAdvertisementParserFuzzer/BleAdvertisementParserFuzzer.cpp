@@ -0,0 +1,89 @@
+/*
+ * BleAdvertisementParserFuzzer.cpp
+ *
+ * libFuzzer target feeding raw advertising data into BleAdvertisementParser, once with and once without bind key.
+ * Build: clang++ -std=c++17 -g -O1 -fsanitize=fuzzer,address,undefined -I.. -o BleAdvertisementParserFuzzer BleAdvertisementParserFuzzer.cpp ../BleAdvertisementParser.cpp ../BtHomeObjects.cpp ../BtHomeCrypto.cpp
+ * Usage: BleAdvertisementParserFuzzer [-runs=...] findings/ corpus/
+ *
+ * Without libFuzzer (e.g. g++), -DFUZZER_REPLAY builds a main which runs the given files once, to check the corpus or a finding:
+ * g++ -std=c++17 -g -O1 -fsanitize=address,undefined -DFUZZER_REPLAY -I.. -o BleAdvertisementParserReplay BleAdvertisementParserFuzzer.cpp ../BleAdvertisementParser.cpp ../BtHomeObjects.cpp ../BtHomeCrypto.cpp
+ * Usage: BleAdvertisementParserReplay file...
+ *
+ * The seed corpus holds the packets of ../../BLEreceiver/shelly_bluht_ble_format.txt (flags and BTHome service data,
+ * the scan response is not part of the advertising data) and one of them encrypted with the bind key below.
+ */ 
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include "BleAdvertisementParser.h"
+
+static const unsigned char address[6] =	{ 0x7C, 0xC6, 0xB6, 0x61, 0xE3, 0xA0 };
+static const char bindKey[] =				"231d39c1d7cc1ab1aee224cd096db932";
+
+
+static time_t Clock()
+{
+	return 1000;
+}
+
+
+static void Check(bool condition, const char* message)
+{
+	if (!condition)
+	{
+		fprintf(stderr, "%s\n", message);
+		abort();
+	}
+}
+
+
+static void Parse(BleAdvertisementParser& parser, const uint8_t* data, size_t size)
+{
+	const unsigned char lastPacketId = parser.GetData().packetId;
+	if (parser.FetchBleData(data, static_cast<int>(size)))
+	{
+		Check(!parser.HasParseError(), "Data reported valid despite a parse error");
+		Check(parser.GetData().packetId != lastPacketId, "Data reported valid without a new packet id");
+	}
+}
+
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	if (size > 255)
+	{
+		return 0;	// Not possible over the air, FetchBleData() rejects more than 31 bytes anyway
+	}
+
+	BleAdvertisementParser plainParser(Clock);
+	Parse(plainParser, data, size);
+
+	BleAdvertisementParser encryptedParser(Clock);
+	encryptedParser.SetBindKey(address, bindKey);
+	Parse(encryptedParser, data, size);
+	return 0;
+}
+
+
+#ifdef FUZZER_REPLAY
+int main(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		FILE* file = fopen(argv[i], "rb");
+		if (!file)
+		{
+			fprintf(stderr, "Cannot open %s\n", argv[i]);
+			return 1;
+		}
+		uint8_t data[256];
+		const size_t size = fread(data, 1, sizeof(data), file);
+		fclose(file);
+
+		LLVMFuzzerTestOneInput(data, size);
+		printf("%s: %u bytes ok\n", argv[i], static_cast<unsigned>(size));
+	}
+	return 0;
+}
+#endif
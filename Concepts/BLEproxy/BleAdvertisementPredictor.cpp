@@ -0,0 +1,109 @@
+#include "BleAdvertisementPredictor.h"
+
+BleAdvertisementPredictor::BleAdvertisementPredictor()
+	: mHasPacket(false)
+	, mLastPacketMs(0)
+	, mIntervalMs(0)
+	, mNextPacketMs(0)
+	, mGuardMs(minGuardMs)
+	, mHits(0)
+	, mMisses(0)
+{
+}
+
+void BleAdvertisementPredictor::OnPacket(const unsigned long nowMs)
+{
+	const unsigned long deltaMs = nowMs - mLastPacketMs;
+	const bool hadPacket = mHasPacket;
+	mHasPacket = true;
+	mLastPacketMs = nowMs;
+
+	if (!hadPacket || deltaMs < minIntervalMs || deltaMs > maxIntervalMs * maxMisses)
+	{
+		return;
+	}
+
+	if (mIntervalMs == 0)
+	{
+		mIntervalMs = deltaMs;
+	}
+	else
+	{
+		// Packets missed in between make the gap a multiple of the interval
+		unsigned long periods = (deltaMs + mIntervalMs / 2) / mIntervalMs;
+		if (periods == 0)
+		{
+			periods = 1;
+		}
+		const long errorMs = static_cast<long>(deltaMs / periods) - static_cast<long>(mIntervalMs);
+
+		if (static_cast<unsigned long>(errorMs < 0 ? -errorMs : errorMs) <= mGuardMs)
+		{
+			// Smooth the clock drift and reception jitter (1/4 weight)
+			mIntervalMs += errorMs / 4;
+			if (mHits < lockHits)
+			{
+				mHits++;
+			}
+			mMisses = 0;
+			mGuardMs = (mGuardMs / 2 > minGuardMs) ? mGuardMs / 2 : minGuardMs;
+		}
+		else
+		{
+			// Sensor changed its period (or sends on events only), start over
+			mIntervalMs = deltaMs;
+			mHits = 0;
+			mGuardMs = minGuardMs;
+		}
+	}
+
+	if (mIntervalMs > maxIntervalMs)
+	{
+		mIntervalMs = 0;
+		mHits = 0;
+	}
+	mNextPacketMs = nowMs + mIntervalMs;
+}
+
+void BleAdvertisementPredictor::Update(const unsigned long nowMs)
+{
+	if (!IsLocked() || !IsAfter(nowMs, mNextPacketMs + mGuardMs))
+	{
+		return;
+	}
+
+	mNextPacketMs += mIntervalMs;
+	mGuardMs = (mGuardMs * 2 < maxGuardMs) ? mGuardMs * 2 : maxGuardMs;
+	if (++mMisses >= maxMisses)
+	{
+		mHits = 0;
+		mMisses = 0;
+		mGuardMs = minGuardMs;
+	}
+}
+
+bool BleAdvertisementPredictor::IsScanDue(const unsigned long nowMs) const
+{
+	return !IsLocked() || !IsAfter(mNextPacketMs - mGuardMs, nowMs);
+}
+
+bool BleAdvertisementPredictor::IsPacketExpectedWithin(const unsigned long nowMs, const unsigned long durationMs) const
+{
+	return IsLocked() && !IsAfter(mNextPacketMs - mGuardMs, nowMs + durationMs);
+}
+
+bool BleAdvertisementPredictor::IsLocked() const
+{
+	return mHits >= lockHits;
+}
+
+unsigned long BleAdvertisementPredictor::GetIntervalMs() const
+{
+	return mIntervalMs;
+}
+
+bool BleAdvertisementPredictor::IsAfter(const unsigned long timeMs, const unsigned long referenceMs)
+{
+	// Wrap-around safe (millis() overflows after ~49 days)
+	return static_cast<long>(timeMs - referenceMs) > 0;
+}
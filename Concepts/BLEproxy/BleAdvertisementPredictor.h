@@ -0,0 +1,42 @@
+#pragma once
+
+/// @brief Learns the advertisement interval and phase of a sensor to predict its next packet (times in [ms], e.g. millis())
+class BleAdvertisementPredictor
+{
+	/// @brief Shortest interval in [ms] taken as advertisement period, repetitions of the same packet are filtered by the parser
+	static constexpr auto minIntervalMs =	1000UL;
+	/// @brief Longest interval in [ms] worth predicting, longer gaps are scanned continuously
+	static constexpr auto maxIntervalMs =	(30UL * 60 * 1000);
+	/// @brief Scan window in [ms] before and after the predicted packet, doubled on every miss up to maxGuardMs
+	static constexpr auto minGuardMs =		1500UL;
+	static constexpr auto maxGuardMs =		12000UL;
+	/// @brief Packets matching the prediction before narrow scanning starts
+	static constexpr auto lockHits =		2;
+	/// @brief Missed windows in a row before falling back to continuous scanning
+	static constexpr auto maxMisses =		3;
+
+public:
+	BleAdvertisementPredictor();
+
+	/// @brief Feed the reception time of each new packet (not of its repetitions)
+	void OnPacket(const unsigned long nowMs);
+	/// @brief Count a miss once the window passed without a packet
+	void Update(const unsigned long nowMs);
+	/// @brief Whether the radio has to scan for this sensor, always true until the interval is known
+	bool IsScanDue(const unsigned long nowMs) const;
+	/// @brief Whether a scan window of this sensor starts within durationMs, false if not locked (no prediction)
+	bool IsPacketExpectedWithin(const unsigned long nowMs, const unsigned long durationMs) const;
+	bool IsLocked() const;
+	unsigned long GetIntervalMs() const;
+
+private:
+	static bool IsAfter(const unsigned long timeMs, const unsigned long referenceMs);
+
+	bool mHasPacket;
+	unsigned long mLastPacketMs;
+	unsigned long mIntervalMs;		// 0 = unknown
+	unsigned long mNextPacketMs;	// Predicted, only valid if locked
+	unsigned long mGuardMs;
+	unsigned char mHits;
+	unsigned char mMisses;
+};
@@ -0,0 +1,76 @@
+#include "BleScanScheduler.h"
+#include "deviceconfig.h"
+#include <ArduinoBLE.h>
+
+BleScanScheduler::BleScanScheduler(BleSensorTable& sensorTable)
+	: mSensorTable(sensorTable)
+	, mScanning(false)
+	, mScanStartMs(0)
+	, mScanTimeMs(0)
+	, mPeriodStartMs(0)
+{
+}
+
+void BleScanScheduler::Update()
+{
+	const unsigned long nowMs = millis();
+	bool scanDue = false;
+
+	mSensorTable.ForEach([&](BleSensor& sensor)
+	{
+		sensor.predictor.Update(nowMs);
+		scanDue |= sensor.predictor.IsScanDue(nowMs);
+	});
+
+	if (scanDue && !mScanning)
+	{
+		mScanning = BLE.scan();
+		mScanStartMs = nowMs;
+	}
+	else if (!scanDue && mScanning)
+	{
+		Stop();
+	}
+
+	if (nowMs - mPeriodStartMs >= reportIntervalMs)
+	{
+		Report(nowMs);
+	}
+}
+
+void BleScanScheduler::Stop()
+{
+	if (mScanning)
+	{
+		BLE.stopScan();
+		mScanning = false;
+		mScanTimeMs += millis() - mScanStartMs;
+	}
+}
+
+unsigned short BleScanScheduler::GetDutyCycle() const
+{
+	const unsigned long nowMs = millis();
+	const unsigned long periodMs = nowMs - mPeriodStartMs;
+	const unsigned long scanTimeMs = mScanTimeMs + (mScanning ? nowMs - mScanStartMs : 0);
+	return periodMs ? static_cast<unsigned short>(static_cast<unsigned long long>(scanTimeMs) * 1000 / periodMs) : 1000;
+}
+
+void BleScanScheduler::Report(const unsigned long nowMs)
+{
+	const unsigned short dutyCycle = GetDutyCycle();
+	DebugTRACE("Scan duty cycle [0.1 %]: "); DebugPRINTLN(dutyCycle);
+
+	mSensorTable.ForEach([](BleSensor& sensor)
+	{
+		DebugTRACE(sensor.config->address); DebugPRINT(sensor.predictor.IsLocked() ? " locked, interval [ms]: " : " scanning, interval [ms]: ");
+		DebugPRINTLN(sensor.predictor.GetIntervalMs());
+	});
+
+	mPeriodStartMs = nowMs;
+	mScanTimeMs = 0;
+	if (mScanning)
+	{
+		mScanStartMs = nowMs;
+	}
+}
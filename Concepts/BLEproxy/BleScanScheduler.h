@@ -0,0 +1,29 @@
+#pragma once
+
+#include "BleSensorTable.h"
+
+/// @brief Scans only around the predicted packets of the configured sensors instead of continuously
+class BleScanScheduler
+{
+	/// @brief Period in [ms] of the scan duty cycle report
+	static constexpr auto reportIntervalMs =	(10UL * 60 * 1000);
+
+public:
+	explicit BleScanScheduler(BleSensorTable& sensorTable);
+
+	/// @brief Start or stop scanning as required by the predictions, call from loop()
+	void Update();
+	/// @brief Stop scanning, e.g. before BLE.end(), the next Update() starts again if due
+	void Stop();
+	/// @brief Scan duty cycle in [0.1 %] of the current report period
+	unsigned short GetDutyCycle() const;
+
+private:
+	void Report(const unsigned long nowMs);
+
+	BleSensorTable& mSensorTable;
+	bool mScanning;
+	unsigned long mScanStartMs;
+	unsigned long mScanTimeMs;		// Accumulated in the current report period
+	unsigned long mPeriodStartMs;
+};
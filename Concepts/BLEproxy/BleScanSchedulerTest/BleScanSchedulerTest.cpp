@@ -0,0 +1,247 @@
+/*
+ * BleScanSchedulerTest.cpp
+ *
+ * Host simulation of the scan scheduling (BleAdvertisementPredictor, BleScanScheduler) against a sensor
+ * advertising periodically with jitter and packet loss. The radio only receives while the scheduler scans.
+ * Build: g++ -std=c++17 -O2 -I../HostStubs -o BleScanSchedulerTest BleScanSchedulerTest.cpp ../BleAdvertisementParser.cpp ../BtHomeObjects.cpp ../BtHomeCrypto.cpp
+ *        (the scheduler sources are included, ArduinoBLE and millis() are simulated, see ../HostStubs)
+ * Usage: BleScanSchedulerTest	(exit code 0 if all scenarios pass)
+ *
+ * Covers locking onto the interval, the scan duty cycle over 6 h at 0 / 10 / 40 % packet loss, the fallback
+ * to continuous scanning after three missed windows, a change of the advertisement period and the wrap-around
+ * of millis() (unsigned long, 32 bit on the device, 64 bit here, same arithmetic).
+ */ 
+
+#include <cstdio>
+#include <cstdlib>
+
+#define BLE_SENSORS { \
+	{ "7c:c6:b6:61:e3:a0", 0, nullptr, nullptr }, \
+}
+
+#include "../BleSensorTable.cpp"
+#include "../BleAdvertisementPredictor.cpp"
+#include "../BleScanScheduler.cpp"
+
+#define STEP_MS						10
+#define JITTER_MS					100
+#define MINUTE_MS					(60UL * 1000)
+#define HOUR_MS						(60 * MINUTE_MS)
+
+BLELocalDevice BLE;
+
+static unsigned long simMs;
+static bool simScanning;
+
+unsigned long millis()
+{
+	return simMs;
+}
+
+int BLELocalDevice::begin()
+{
+	return 1;
+}
+
+void BLELocalDevice::end()
+{
+}
+
+int BLELocalDevice::scan(bool)
+{
+	simScanning = true;
+	return 1;
+}
+
+void BLELocalDevice::stopScan()
+{
+	simScanning = false;
+}
+
+
+/// @brief The simulated sensor and radio, the proxy's loop() reduced to the scheduling
+class Simulation
+{
+public:
+	explicit Simulation(const unsigned long startMs)
+		: mPeriodMs(60000)
+		, mLossPercent(0)
+		, mSilent(false)
+		, mScanMs(0)
+		, mSent(0)
+		, mReceived(0)
+		, mTable()
+		, mSensor(nullptr)
+		, mScheduler(mTable)
+		, mNextTxMs(startMs + 5000)
+	{
+		simMs = startMs;
+		simScanning = false;
+		mSensor = mTable.Find("7c:c6:b6:61:e3:a0");
+	}
+
+	void Run(const unsigned long durationMs)
+	{
+		for (unsigned long elapsedMs = 0; elapsedMs < durationMs; elapsedMs += STEP_MS, simMs += STEP_MS)
+		{
+			mScheduler.Update();
+			if (simScanning)
+			{
+				mScanMs += STEP_MS;
+			}
+			if (static_cast<long>(simMs - mNextTxMs) >= 0)
+			{
+				Transmit();
+			}
+		}
+	}
+
+	void ResetStatistics()
+	{
+		mScanMs = 0;
+		mSent = 0;
+		mReceived = 0;
+	}
+
+	BleAdvertisementPredictor& predictor() { return mSensor->predictor; }
+
+	unsigned long mPeriodMs;
+	unsigned char mLossPercent;
+	bool mSilent;
+	unsigned long mScanMs;
+	unsigned long mSent;			// Not lost on air
+	unsigned long mReceived;
+
+private:
+	void Transmit()
+	{
+		mNextTxMs += mPeriodMs + (rand() % (2 * JITTER_MS + 1)) - JITTER_MS;
+		if (mSilent || static_cast<unsigned char>(rand() % 100) < mLossPercent)
+		{
+			return;
+		}
+		mSent++;
+		if (simScanning)
+		{
+			mReceived++;
+			mSensor->predictor.OnPacket(simMs);
+		}
+	}
+
+	BleSensorTable mTable;
+	BleSensor* mSensor;
+	BleScanScheduler mScheduler;
+	unsigned long mNextTxMs;
+};
+
+
+static int failures;
+
+static void Check(const bool condition, const char* scenario, const char* message)
+{
+	if (!condition)
+	{
+		printf("%s: FAILED, %s\n", scenario, message);
+		failures++;
+	}
+}
+
+
+static void TestLock()
+{
+	Simulation simulation(0);
+	simulation.Run(10 * MINUTE_MS);
+
+	const long errorMs = static_cast<long>(simulation.predictor().GetIntervalMs()) - 60000;
+	Check(simulation.predictor().IsLocked(), "lock", "not locked after 10 periods");
+	Check(labs(errorMs) <= 2 * JITTER_MS, "lock", "interval off");
+	printf("lock: interval %lu ms\n", simulation.predictor().GetIntervalMs());
+}
+
+
+static void TestDutyCycle(const unsigned char lossPercent, const double maxDutyCycle)
+{
+	Simulation simulation(0);
+	simulation.mLossPercent = lossPercent;
+	simulation.Run(6 * HOUR_MS);
+
+	const double dutyCycle = 100.0 * simulation.mScanMs / (6 * HOUR_MS);
+	const double reception = 100.0 * simulation.mReceived / simulation.mSent;
+	printf("duty cycle at %u %% loss: %.1f %% (max. %.1f), %.1f %% of the packets on air received\n",
+		lossPercent, dutyCycle, maxDutyCycle, reception);
+	Check(dutyCycle <= maxDutyCycle, "duty cycle", "too much scanning");
+	Check(reception >= 95.0, "duty cycle", "packets missed while not scanning");
+}
+
+
+static void TestFallback()
+{
+	Simulation simulation(0);
+	simulation.Run(10 * MINUTE_MS);
+	Check(simulation.predictor().IsLocked(), "fallback", "not locked");
+
+	// Three windows (guard 1.5, 3, 6 s) pass without a packet
+	simulation.mSilent = true;
+	simulation.Run(2 * MINUTE_MS);
+	Check(simulation.predictor().IsLocked(), "fallback", "gave up before the third miss");
+	simulation.Run(MINUTE_MS + 10000);
+	Check(!simulation.predictor().IsLocked(), "fallback", "still locked after three misses");
+	simulation.ResetStatistics();
+	simulation.Run(5 * MINUTE_MS);
+	Check(simulation.mScanMs == 5 * MINUTE_MS, "fallback", "not scanning continuously");
+
+	// Locks again once the sensor is back
+	simulation.mSilent = false;
+	simulation.Run(5 * MINUTE_MS);
+	Check(simulation.predictor().IsLocked(), "fallback", "no lock after the sensor is back");
+	printf("fallback: done\n");
+}
+
+
+// A change to a multiple or a fraction of the period keeps the lock, every n-th packet still hits the window
+static void TestPeriodChange(const unsigned long periodMs)
+{
+	Simulation simulation(0);
+	simulation.Run(10 * MINUTE_MS);
+
+	simulation.mPeriodMs = periodMs;
+	simulation.Run(15 * MINUTE_MS);
+	const long errorMs = static_cast<long>(simulation.predictor().GetIntervalMs()) - static_cast<long>(periodMs);
+	Check(simulation.predictor().IsLocked(), "period change", "not locked to the new period");
+	Check(labs(errorMs) <= 2 * JITTER_MS, "period change", "interval off");
+	printf("period change to %lu ms: interval %lu ms\n", periodMs, simulation.predictor().GetIntervalMs());
+}
+
+
+static void TestWrap()
+{
+	// millis() wraps 10 minutes after the start
+	Simulation simulation(0UL - 10 * MINUTE_MS);
+	simulation.Run(10 * MINUTE_MS);
+	Check(simulation.predictor().IsLocked(), "wrap", "not locked");
+
+	simulation.ResetStatistics();
+	simulation.Run(HOUR_MS);
+	const double dutyCycle = 100.0 * simulation.mScanMs / HOUR_MS;
+	Check(simulation.predictor().IsLocked(), "wrap", "lost the lock at the wrap");
+	Check(simulation.mReceived == simulation.mSent, "wrap", "packets missed");
+	Check(dutyCycle <= 5.0, "wrap", "too much scanning");
+	printf("wrap: duty cycle %.1f %%\n", dutyCycle);
+}
+
+
+int main()
+{
+	srand(1);
+	TestLock();
+	TestDutyCycle(0, 5.0);
+	TestDutyCycle(10, 8.0);
+	TestDutyCycle(40, 25.0);
+	TestFallback();
+	TestPeriodChange(47000);
+	TestPeriodChange(100000);
+	TestWrap();
+
+	printf(failures ? "FAILED\n" : "passed\n");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,118 @@
+#include "BleSensorTable.h"
+#include <string.h>
+
+constexpr BleSensorConfig BleSensorTable::cSensorConfig[];
+
+bool BleSensor::IsSendingDue(const time_t now) const
+{
+	return (lastSendTime == 0) || (difftime(now, lastSendTime) >= minSendingInterval);
+}
+
+BleSensorTable::BleSensorTable()
+	: mSensors()
+	, mIndex()
+	, mCount(0)
+{
+	for (const auto& config : cSensorConfig)
+	{
+		unsigned char address[6];
+		if (!ParseAddress(config.address, address) || Find(address))
+		{
+			DebugTRACE("Invalid or duplicate address "); DebugPRINTLN(config.address);
+			continue;
+		}
+
+		BleSensor& sensor = mSensors[mCount];
+		if (!sensor.parser.SetBindKey(address, config.bindKey))
+		{
+			DebugTRACE("Invalid bind key for "); DebugPRINTLN(config.address);
+			continue;
+		}
+		memcpy(sensor.address, address, sizeof(address));
+		sensor.config = &config;
+
+		unsigned char i = Hash(address);
+		while (mIndex[i])
+		{
+			i = (i + 1) & (indexTableSize - 1);
+		}
+		mIndex[i] = ++mCount;
+	}
+}
+
+BleSensor* BleSensorTable::Find(BLEDevice& device)
+{
+	return Find(device.address().c_str());
+}
+
+BleSensor* BleSensorTable::Find(const char* address)
+{
+	unsigned char binaryAddress[6];
+	return ParseAddress(address, binaryAddress) ? Find(binaryAddress) : nullptr;
+}
+
+BleSensor* BleSensorTable::Find(const unsigned char address[6])
+{
+	unsigned char i = Hash(address);
+
+	// Terminates at the first unused entry, the table is never more than half full (see indexTableSize)
+	while (mIndex[i])
+	{
+		BleSensor& sensor = mSensors[mIndex[i] - 1];
+		if (memcmp(sensor.address, address, sizeof(sensor.address)) == 0)
+		{
+			return &sensor;
+		}
+		i = (i + 1) & (indexTableSize - 1);
+	}
+	return nullptr;
+}
+
+unsigned char BleSensorTable::GetCount() const
+{
+	return mCount;
+}
+
+bool BleSensorTable::ParseAddress(const char* text, unsigned char address[6])
+{
+	for (unsigned char i = 0; i < 6; i++)
+	{
+		unsigned char value = 0;
+		for (unsigned char digit = 0; digit < 2; digit++, text++)
+		{
+			const char c = *text;
+			value <<= 4;
+			if (c >= '0' && c <= '9')
+			{
+				value |= c - '0';
+			}
+			else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+			{
+				value |= (c | 0x20) - 'a' + 10;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		address[i] = value;
+
+		if (*text != (i < 5 ? ':' : '\0'))
+		{
+			return false;
+		}
+		text++;
+	}
+	return true;
+}
+
+unsigned char BleSensorTable::Hash(const unsigned char address[6])
+{
+	// FNV-1a, the vendor part (OUI) is usually the same for all sensors
+	unsigned long hash = 2166136261UL;
+	for (unsigned char i = 0; i < 6; i++)
+	{
+		hash = (hash ^ address[i]) * 16777619UL;
+	}
+	return (hash ^ (hash >> 16)) & (indexTableSize - 1);
+}
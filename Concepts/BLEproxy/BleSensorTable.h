@@ -0,0 +1,82 @@
+#pragma once
+
+#include "BleAdvertisementParser.h"
+#include "BleAdvertisementPredictor.h"
+#include "credentials.h"
+#include "deviceconfig.h"
+#include <ArduinoBLE.h>
+#include <ctime>
+
+#ifndef SHELLY_BLUHT_BINDKEY
+#define SHELLY_BLUHT_BINDKEY		nullptr		/* Not in older credentials.h, unencrypted */
+#endif
+
+/// @brief Static configuration of a sensor (see BLE_SENSORS in deviceconfig.h)
+struct BleSensorConfig
+{
+	const char* address;			// MAC as reported by BLEDevice::address(), e.g. "7c:c6:b6:61:e3:a0"
+	unsigned char bresserChannel;	// [ 1..3, 0 = none ] channel on the RF path to the weather station
+	const char* aprsObjectName;		// [ max. 9 characters, nullptr = weather report of this station ]
+	const char* bindKey;			// [ 32 hex digits, nullptr = unencrypted ] BTHome encryption key
+};
+
+struct BleSensor
+{
+	/// @brief Time in [s] to suppress forwarding packets of the same sensor
+	static constexpr auto minSendingInterval =	(5 * 60);
+
+	bool IsSendingDue(const time_t now) const;
+
+	unsigned char address[6];
+	const BleSensorConfig* config;
+	BleAdvertisementParser parser;	// Incl. packet ID deduplication and data age
+	BleAdvertisementPredictor predictor;	// Scan windows, fed with the new packets of the parser
+	time_t lastSendTime;
+	bool uploadPending;				// Queued for the next WiFi window (see RadioCoexistence)
+	BtHomeData uploadData;
+};
+
+/// @brief Smallest power of 2 >= n
+constexpr unsigned long NextPowerOf2(const unsigned long n, const unsigned long power = 1)
+{
+	return (power >= n) ? power : NextPowerOf2(n, power * 2);
+}
+
+/// @brief The configured sensors (BLE_SENSORS), found by MAC via a hash table (open addressing) of indices into them
+class BleSensorTable
+{
+	static constexpr BleSensorConfig cSensorConfig[] = BLE_SENSORS;
+	static constexpr auto sensorCount =		sizeof(cSensorConfig) / sizeof(cSensorConfig[0]);
+	/// @brief Number of hash table entries, power of 2 and at least twice the number of sensors to keep the probe sequences short
+	static constexpr auto indexTableSize =	NextPowerOf2(2 * sensorCount);
+
+	static_assert(sensorCount > 0 && indexTableSize <= 0x100, "1..128 sensors, the hash table is indexed by 8 bit");
+
+public:
+	BleSensorTable();
+
+	/// @brief Entry of the device, nullptr if it is not a configured sensor
+	BleSensor* Find(BLEDevice& device);
+	BleSensor* Find(const char* address);
+
+	unsigned char GetCount() const;
+
+	/// @brief Call function(BleSensor&) for each configured sensor
+	template<typename Function>
+	void ForEach(Function function)
+	{
+		for (unsigned char i = 0; i < mCount; i++)
+		{
+			function(mSensors[i]);
+		}
+	}
+
+private:
+	static bool ParseAddress(const char* text, unsigned char address[6]);
+	static unsigned char Hash(const unsigned char address[6]);
+	BleSensor* Find(const unsigned char address[6]);
+
+	BleSensor mSensors[sensorCount];		// Valid sensors first, in configuration order
+	unsigned char mIndex[indexTableSize];	// Index into mSensors + 1, 0 = unused entry
+	unsigned char mCount;
+};
@@ -0,0 +1,227 @@
+#include "BtHomeCrypto.h"
+#include <string.h>
+
+namespace
+{
+	constexpr unsigned char cSbox[256] =
+	{
+		0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5, 0x30, 0x01, 0x67, 0x2B, 0xFE, 0xD7, 0xAB, 0x76,
+		0xCA, 0x82, 0xC9, 0x7D, 0xFA, 0x59, 0x47, 0xF0, 0xAD, 0xD4, 0xA2, 0xAF, 0x9C, 0xA4, 0x72, 0xC0,
+		0xB7, 0xFD, 0x93, 0x26, 0x36, 0x3F, 0xF7, 0xCC, 0x34, 0xA5, 0xE5, 0xF1, 0x71, 0xD8, 0x31, 0x15,
+		0x04, 0xC7, 0x23, 0xC3, 0x18, 0x96, 0x05, 0x9A, 0x07, 0x12, 0x80, 0xE2, 0xEB, 0x27, 0xB2, 0x75,
+		0x09, 0x83, 0x2C, 0x1A, 0x1B, 0x6E, 0x5A, 0xA0, 0x52, 0x3B, 0xD6, 0xB3, 0x29, 0xE3, 0x2F, 0x84,
+		0x53, 0xD1, 0x00, 0xED, 0x20, 0xFC, 0xB1, 0x5B, 0x6A, 0xCB, 0xBE, 0x39, 0x4A, 0x4C, 0x58, 0xCF,
+		0xD0, 0xEF, 0xAA, 0xFB, 0x43, 0x4D, 0x33, 0x85, 0x45, 0xF9, 0x02, 0x7F, 0x50, 0x3C, 0x9F, 0xA8,
+		0x51, 0xA3, 0x40, 0x8F, 0x92, 0x9D, 0x38, 0xF5, 0xBC, 0xB6, 0xDA, 0x21, 0x10, 0xFF, 0xF3, 0xD2,
+		0xCD, 0x0C, 0x13, 0xEC, 0x5F, 0x97, 0x44, 0x17, 0xC4, 0xA7, 0x7E, 0x3D, 0x64, 0x5D, 0x19, 0x73,
+		0x60, 0x81, 0x4F, 0xDC, 0x22, 0x2A, 0x90, 0x88, 0x46, 0xEE, 0xB8, 0x14, 0xDE, 0x5E, 0x0B, 0xDB,
+		0xE0, 0x32, 0x3A, 0x0A, 0x49, 0x06, 0x24, 0x5C, 0xC2, 0xD3, 0xAC, 0x62, 0x91, 0x95, 0xE4, 0x79,
+		0xE7, 0xC8, 0x37, 0x6D, 0x8D, 0xD5, 0x4E, 0xA9, 0x6C, 0x56, 0xF4, 0xEA, 0x65, 0x7A, 0xAE, 0x08,
+		0xBA, 0x78, 0x25, 0x2E, 0x1C, 0xA6, 0xB4, 0xC6, 0xE8, 0xDD, 0x74, 0x1F, 0x4B, 0xBD, 0x8B, 0x8A,
+		0x70, 0x3E, 0xB5, 0x66, 0x48, 0x03, 0xF6, 0x0E, 0x61, 0x35, 0x57, 0xB9, 0x86, 0xC1, 0x1D, 0x9E,
+		0xE1, 0xF8, 0x98, 0x11, 0x69, 0xD9, 0x8E, 0x94, 0x9B, 0x1E, 0x87, 0xE9, 0xCE, 0x55, 0x28, 0xDF,
+		0x8C, 0xA1, 0x89, 0x0D, 0xBF, 0xE6, 0x42, 0x68, 0x41, 0x99, 0x2D, 0x0F, 0xB0, 0x54, 0xBB, 0x16,
+	};
+
+	inline unsigned char xtime(const unsigned char x)
+	{
+		return (x << 1) ^ ((x & 0x80) ? 0x1B : 0x00);
+	}
+
+	bool ParseHexByte(const char* text, unsigned char& value)
+	{
+		value = 0;
+		for (unsigned char digit = 0; digit < 2; digit++)
+		{
+			const char c = text[digit];
+			value <<= 4;
+			if (c >= '0' && c <= '9')
+			{
+				value |= c - '0';
+			}
+			else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+			{
+				value |= (c | 0x20) - 'a' + 10;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+BtHomeCrypto::BtHomeCrypto()
+	: mRoundKeys()
+	, mEnabled(false)
+	, mCounterValid(false)
+	, mLastCounter(0)
+{
+}
+
+bool BtHomeCrypto::SetKey(const char* hexKey)
+{
+	mEnabled = false;
+	mCounterValid = false;
+	if (!hexKey)
+	{
+		return true;
+	}
+
+	for (unsigned char i = 0; i < keyLength; i++)
+	{
+		if (!ParseHexByte(&hexKey[2 * i], mRoundKeys[i]))
+		{
+			return false;
+		}
+	}
+	if (hexKey[2 * keyLength] != '\0')
+	{
+		return false;
+	}
+
+	// AES-128 key expansion
+	unsigned char rcon = 0x01;
+	for (unsigned char i = keyLength; i < sizeof(mRoundKeys); i += 4)
+	{
+		unsigned char temp[4];
+		memcpy(temp, &mRoundKeys[i - 4], sizeof(temp));
+		if ((i % keyLength) == 0)
+		{
+			const unsigned char first = temp[0];
+			temp[0] = cSbox[temp[1]] ^ rcon;
+			temp[1] = cSbox[temp[2]];
+			temp[2] = cSbox[temp[3]];
+			temp[3] = cSbox[first];
+			rcon = xtime(rcon);
+		}
+		for (unsigned char j = 0; j < 4; j++)
+		{
+			mRoundKeys[i + j] = mRoundKeys[i + j - keyLength] ^ temp[j];
+		}
+	}
+
+	mEnabled = true;
+	return true;
+}
+
+bool BtHomeCrypto::IsEnabled() const
+{
+	return mEnabled;
+}
+
+void BtHomeCrypto::EncryptBlock(const unsigned char in[blockLength], unsigned char out[blockLength]) const
+{
+	unsigned char state[blockLength];
+	for (unsigned char i = 0; i < blockLength; i++)
+	{
+		state[i] = in[i] ^ mRoundKeys[i];
+	}
+
+	for (unsigned char round = 1; round <= rounds; round++)
+	{
+		// SubBytes and ShiftRows (state is column major)
+		unsigned char shifted[blockLength];
+		for (unsigned char i = 0; i < blockLength; i++)
+		{
+			shifted[i] = cSbox[state[(i + 4 * (i % 4)) % blockLength]];
+		}
+
+		// MixColumns (skipped in the last round) and AddRoundKey
+		const unsigned char* roundKey = &mRoundKeys[round * blockLength];
+		for (unsigned char c = 0; c < blockLength; c += 4)
+		{
+			const unsigned char a0 = shifted[c], a1 = shifted[c + 1], a2 = shifted[c + 2], a3 = shifted[c + 3];
+			if (round < rounds)
+			{
+				const unsigned char all = a0 ^ a1 ^ a2 ^ a3;
+				state[c]     = a0 ^ all ^ xtime(a0 ^ a1);
+				state[c + 1] = a1 ^ all ^ xtime(a1 ^ a2);
+				state[c + 2] = a2 ^ all ^ xtime(a2 ^ a3);
+				state[c + 3] = a3 ^ all ^ xtime(a3 ^ a0);
+			}
+			else
+			{
+				memcpy(&state[c], &shifted[c], 4);
+			}
+			for (unsigned char j = 0; j < 4; j++)
+			{
+				state[c + j] ^= roundKey[c + j];
+			}
+		}
+	}
+
+	memcpy(out, state, blockLength);
+}
+
+bool BtHomeCrypto::Decrypt(const unsigned char address[6], const unsigned char* uuidAndDeviceInfo,
+	const unsigned char* encryptedData, unsigned char dataLen, const unsigned char* counterAndMic, unsigned char* plainData)
+{
+	if (!mEnabled)
+	{
+		return false;
+	}
+
+	const unsigned long counter = counterAndMic[0] | (counterAndMic[1] << 8) | (static_cast<unsigned long>(counterAndMic[2]) << 16) | (static_cast<unsigned long>(counterAndMic[3]) << 24);
+	if (mCounterValid && counter <= mLastCounter)
+	{
+		return false; // Replayed
+	}
+
+	// CCM with L = 2 (15 - nonce length), M = 4, no associated data
+	// Nonce = MAC, UUID, device info, counter
+	unsigned char ctr[blockLength];
+	ctr[0] = 2 - 1;
+	memcpy(&ctr[1], address, 6);
+	memcpy(&ctr[7], uuidAndDeviceInfo, 3);
+	memcpy(&ctr[10], counterAndMic, counterLength);
+	ctr[14] = 0;
+	ctr[15] = 0;
+
+	// Decrypt (CTR, A1..An)
+	unsigned char keyStream[blockLength];
+	for (unsigned char offset = 0; offset < dataLen; offset += blockLength)
+	{
+		ctr[15]++;
+		EncryptBlock(ctr, keyStream);
+		for (unsigned char i = 0; i < blockLength && offset + i < dataLen; i++)
+		{
+			plainData[offset + i] = encryptedData[offset + i] ^ keyStream[i];
+		}
+	}
+
+	// Authenticate (CBC-MAC over B0 and the zero padded plain data)
+	unsigned char mac[blockLength];
+	mac[0] = (((micLength - 2) / 2) << 3) | (2 - 1);
+	memcpy(&mac[1], &ctr[1], nonceLength);
+	mac[14] = 0;
+	mac[15] = dataLen;
+	EncryptBlock(mac, mac);
+	for (unsigned char offset = 0; offset < dataLen; offset += blockLength)
+	{
+		for (unsigned char i = 0; i < blockLength && offset + i < dataLen; i++)
+		{
+			mac[i] ^= plainData[offset + i];
+		}
+		EncryptBlock(mac, mac);
+	}
+
+	// MIC = MAC ^ S0 (A0)
+	ctr[15] = 0;
+	EncryptBlock(ctr, keyStream);
+	unsigned char difference = 0;
+	for (unsigned char i = 0; i < micLength; i++)
+	{
+		difference |= (mac[i] ^ keyStream[i]) ^ counterAndMic[counterLength + i];
+	}
+	if (difference)
+	{
+		memset(plainData, 0, dataLen);
+		return false;
+	}
+
+	mLastCounter = counter;
+	mCounterValid = true;
+	return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+/// @brief AES-128-CCM decryption of BTHome v2 service data (see https://bthome.io/encryption/) incl. replay protection
+class BtHomeCrypto
+{
+public:
+	static constexpr auto keyLength =		16;
+	static constexpr auto counterLength =	4;
+	static constexpr auto micLength =		4;
+
+	BtHomeCrypto();
+
+	/// @brief Expand the bind key (32 hex digits) into the AES key schedule, nullptr disables decryption
+	bool SetKey(const char* hexKey);
+	bool IsEnabled() const;
+
+	/// @brief Decrypt and authenticate the payload, the counter must be higher than the one of the last authentic packet
+	/// @param uuidAndDeviceInfo BTHome UUID (2 bytes) and device info byte as received, part of the nonce
+	/// @param counterAndMic Counter (4 bytes) and MIC (4 bytes) following the encrypted data
+	bool Decrypt(const unsigned char address[6], const unsigned char* uuidAndDeviceInfo,
+		const unsigned char* encryptedData, unsigned char dataLen, const unsigned char* counterAndMic, unsigned char* plainData);
+
+private:
+	static constexpr auto blockLength =		16;
+	static constexpr auto rounds =			10;
+	static constexpr auto nonceLength =		13;
+
+	void EncryptBlock(const unsigned char in[blockLength], unsigned char out[blockLength]) const;
+
+	unsigned char mRoundKeys[(rounds + 1) * blockLength];	// Precomputed once per device
+	bool mEnabled;
+	bool mCounterValid;
+	unsigned long mLastCounter;
+};
@@ -0,0 +1,189 @@
+#include "BtHomeObjects.h"
+
+namespace
+{
+	constexpr BtHomeObject U(const unsigned char length, const signed char exponent, const BtHomeField field = BtHomeField::None)
+	{
+		return { length, false, exponent, field };
+	}
+
+	constexpr BtHomeObject S(const unsigned char length, const signed char exponent, const BtHomeField field = BtHomeField::None)
+	{
+		return { length, true, exponent, field };
+	}
+
+	/// @brief Sensor data, binary sensor data and events, indexed by object ID 0x00..
+	constexpr BtHomeObject cObjects[] =
+	{
+		/* 0x00 packet id */			U(1,  0, BtHomeField::PacketId),
+		/* 0x01 battery */				U(1,  0, BtHomeField::Battery),
+		/* 0x02 temperature */			S(2, -2, BtHomeField::Temperature),
+		/* 0x03 humidity */				U(2, -2, BtHomeField::Humidity),
+		/* 0x04 pressure */				U(3, -2),
+		/* 0x05 illuminance */			U(3, -2),
+		/* 0x06 mass (kg) */			U(2, -2),
+		/* 0x07 mass (lb) */			U(2, -2),
+		/* 0x08 dewpoint */				S(2, -2),
+		/* 0x09 count */				U(1,  0),
+		/* 0x0A energy */				U(3, -3),
+		/* 0x0B power */				U(3, -2),
+		/* 0x0C voltage */				U(2, -3),
+		/* 0x0D pm2.5 */				U(2,  0),
+		/* 0x0E pm10 */					U(2,  0),
+		/* 0x0F generic boolean */		U(1,  0),
+		/* 0x10 power */				U(1,  0),
+		/* 0x11 opening */				U(1,  0),
+		/* 0x12 co2 */					U(2,  0),
+		/* 0x13 tvoc */					U(2,  0),
+		/* 0x14 moisture */				U(2, -2),
+		/* 0x15 battery low */			U(1,  0),
+		/* 0x16 battery charging */		U(1,  0),
+		/* 0x17 carbon monoxide */		U(1,  0),
+		/* 0x18 cold */					U(1,  0),
+		/* 0x19 connectivity */			U(1,  0),
+		/* 0x1A door */					U(1,  0),
+		/* 0x1B garage door */			U(1,  0),
+		/* 0x1C gas */					U(1,  0),
+		/* 0x1D heat */					U(1,  0),
+		/* 0x1E light */				U(1,  0),
+		/* 0x1F lock */					U(1,  0),
+		/* 0x20 moisture */				U(1,  0),
+		/* 0x21 motion */				U(1,  0),
+		/* 0x22 moving */				U(1,  0),
+		/* 0x23 occupancy */			U(1,  0),
+		/* 0x24 plug */					U(1,  0),
+		/* 0x25 presence */				U(1,  0),
+		/* 0x26 problem */				U(1,  0),
+		/* 0x27 running */				U(1,  0),
+		/* 0x28 safety */				U(1,  0),
+		/* 0x29 smoke */				U(1,  0),
+		/* 0x2A sound */				U(1,  0),
+		/* 0x2B tamper */				U(1,  0),
+		/* 0x2C vibration */			U(1,  0),
+		/* 0x2D window */				U(1,  0),
+		/* 0x2E humidity */				U(1,  0, BtHomeField::Humidity),
+		/* 0x2F moisture */				U(1,  0),
+		/* 0x30 */						U(0,  0),
+		/* 0x31 */						U(0,  0),
+		/* 0x32 */						U(0,  0),
+		/* 0x33 */						U(0,  0),
+		/* 0x34 */						U(0,  0),
+		/* 0x35 */						U(0,  0),
+		/* 0x36 */						U(0,  0),
+		/* 0x37 */						U(0,  0),
+		/* 0x38 */						U(0,  0),
+		/* 0x39 */						U(0,  0),
+		/* 0x3A button */				U(1,  0, BtHomeField::Button),
+		/* 0x3B */						U(0,  0),
+		/* 0x3C dimmer */				U(2,  0),
+		/* 0x3D count */				U(2,  0),
+		/* 0x3E count */				U(4,  0),
+		/* 0x3F rotation */				S(2, -1),
+		/* 0x40 distance (mm) */		U(2,  0),
+		/* 0x41 distance (m) */			U(2, -1),
+		/* 0x42 duration */				U(3, -3),
+		/* 0x43 current */				U(2, -3),
+		/* 0x44 speed */				U(2, -2),
+		/* 0x45 temperature */			S(2, -1, BtHomeField::Temperature),
+		/* 0x46 UV index */				U(1, -1),
+		/* 0x47 volume (l) */			U(2, -1),
+		/* 0x48 volume (ml) */			U(2,  0),
+		/* 0x49 volume flow rate */		U(2, -3),
+		/* 0x4A voltage */				U(2, -1),
+		/* 0x4B gas */					U(3, -3),
+		/* 0x4C gas */					U(4, -3),
+		/* 0x4D energy */				U(4, -3),
+		/* 0x4E volume */				U(4, -3),
+		/* 0x4F water */				U(4, -3),
+		/* 0x50 timestamp */			U(4,  0),
+		/* 0x51 acceleration */			U(2, -3),
+		/* 0x52 gyroscope */			U(2, -3),
+		/* 0x53 text */					U(BtHomeObjects::variableLength, 0),
+		/* 0x54 raw */					U(BtHomeObjects::variableLength, 0),
+		/* 0x55 volume storage */		U(4, -3),
+		/* 0x56 conductivity */			U(2,  0),
+		/* 0x57 temperature */			S(1,  0),
+		/* 0x58 temperature (0.35) */	S(1,  0),
+		/* 0x59 count */				S(1,  0),
+		/* 0x5A count */				S(2,  0),
+		/* 0x5B count */				S(4,  0),
+		/* 0x5C power */				S(4, -2),
+		/* 0x5D current */				S(2, -3),
+		/* 0x5E direction */			U(2, -2),
+		/* 0x5F precipitation */		U(2,  0),
+		/* 0x60 channel */				U(1,  0),
+		/* 0x61 rotational speed */		U(2,  0),
+	};
+	static_assert(sizeof(cObjects) / sizeof(cObjects[0]) == 0x62, "Object IDs must be contiguous");
+
+	/// @brief Device information, indexed by object ID 0xF0..
+	constexpr unsigned char cDeviceObjectsFirstId = 0xF0;
+	constexpr BtHomeObject cDeviceObjects[] =
+	{
+		/* 0xF0 device type id */		U(2,  0),
+		/* 0xF1 firmware version */		U(4,  0),
+		/* 0xF2 firmware version */		U(3,  0),
+	};
+
+	/// @brief Unit of the fields in BtHomeData as exponent of 10, indexed by BtHomeField
+	constexpr signed char cFieldExponents[] = { 0, 0, 0, -1, 0, 0 };
+	static_assert(sizeof(cFieldExponents) == static_cast<unsigned char>(BtHomeField::Count), "Exponent missing");
+
+	constexpr long cPowersOf10[] = { 1, 10, 100, 1000, 10000 };
+}
+
+const BtHomeObject* BtHomeObjects::Find(const unsigned char objectId)
+{
+	const BtHomeObject* object = nullptr;
+	if (objectId < sizeof(cObjects) / sizeof(cObjects[0]))
+	{
+		object = &cObjects[objectId];
+	}
+	else if (objectId >= cDeviceObjectsFirstId && objectId < cDeviceObjectsFirstId + sizeof(cDeviceObjects) / sizeof(cDeviceObjects[0]))
+	{
+		object = &cDeviceObjects[objectId - cDeviceObjectsFirstId];
+	}
+	return (object && object->length) ? object : nullptr;
+}
+
+void BtHomeObjects::Decode(const BtHomeObject& object, const unsigned char* const payload, BtHomeData& data)
+{
+	if (object.field == BtHomeField::None || object.length > 4)
+	{
+		return;
+	}
+
+	unsigned long raw = 0;
+	for (unsigned char i = object.length; i > 0; i--)
+	{
+		raw = (raw << 8) | payload[i - 1];
+	}
+
+	long value = static_cast<long>(raw);
+	if (object.isSigned && object.length < 4 && (raw & (1UL << (8 * object.length - 1))))
+	{
+		value -= (1L << (8 * object.length));
+	}
+
+	// Convert into the unit of the field
+	const signed char shift = object.exponent - cFieldExponents[static_cast<unsigned char>(object.field)];
+	if (shift > 0)
+	{
+		value *= cPowersOf10[shift];
+	}
+	else if (shift < 0)
+	{
+		value /= cPowersOf10[-shift];
+	}
+
+	switch (object.field)
+	{
+	case BtHomeField::PacketId:		data.packetId = static_cast<unsigned char>(value);		break;
+	case BtHomeField::Battery:		data.batteryLevel = static_cast<unsigned char>(value);	break;
+	case BtHomeField::Temperature:	data.temperature = static_cast<short>(value);			break;
+	case BtHomeField::Humidity:		data.humidity = static_cast<unsigned char>(value);		break;
+	case BtHomeField::Button:		data.buttonEvent = static_cast<unsigned char>(value);	break;
+	default:						return;
+	}
+	data.present |= (1 << static_cast<unsigned char>(object.field));
+}
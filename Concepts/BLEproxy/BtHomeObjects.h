@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+
+/// @brief Fields of BtHomeData the decoder stores object values in
+enum class BtHomeField : unsigned char
+{
+	None = 0,
+	PacketId,
+	Battery,
+	Temperature,
+	Humidity,
+	Button,
+	Count
+};
+
+/// @brief Decoded values, a field is only valid if contained in the packet (see Has())
+struct BtHomeData
+{
+	unsigned char present;			// Bit (1 << BtHomeField) set for each decoded field
+	unsigned char packetId;			// [ 0..255 ]
+	unsigned char batteryLevel;		// [ % ]
+	unsigned char humidity;			// [ % ]
+	short temperature;				// [ 0.1 °C ]
+	unsigned char buttonEvent;		// [ 0 = none, 1 = press, 2 = double press, ... ]
+
+	bool Has(const BtHomeField field) const { return present & (1 << static_cast<unsigned char>(field)); }
+};
+
+/// @brief Format of an object ID of the BTHome v2 standard (see https://bthome.io/format/)
+struct BtHomeObject
+{
+	unsigned char length;			// Payload length [ bytes ], variableLength: first payload byte holds the length
+	bool isSigned;
+	signed char exponent;			// Factor 10^exponent
+	BtHomeField field;
+};
+
+class BtHomeObjects
+{
+public:
+	static constexpr unsigned char variableLength = 0xFF;
+
+	/// @brief Format of the object ID, nullptr if unknown (size unknown as well, parsing cannot continue)
+	static const BtHomeObject* Find(const unsigned char objectId);
+
+	/// @brief Decode the payload of a fixed length object (max. 4 bytes, little endian) and store it in its field
+	static void Decode(const BtHomeObject& object, const unsigned char* const payload, BtHomeData& data);
+};
@@ -0,0 +1,44 @@
+/*
+ * ArduinoBLE.h
+ *
+ * Host stub of the ArduinoBLE and Arduino core parts used by the BLE proxy, for the host tests
+ * (BleScanSchedulerTest, RadioCoexistenceTest). The tests implement the functions and model the radio.
+ */ 
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+unsigned long millis();
+
+class String
+{
+public:
+	String(const char* text = "") : mText(text) {}
+	const char* c_str() const { return mText; }
+
+private:
+	const char* mText;
+};
+
+class BLEDevice
+{
+public:
+	explicit BLEDevice(const char* address = "") : mAddress(address) {}
+	String address() const { return String(mAddress); }
+
+private:
+	const char* mAddress;
+};
+
+class BLELocalDevice
+{
+public:
+	int begin();
+	void end();
+	int scan(bool withDuplicates = false);
+	void stopScan();
+};
+
+extern BLELocalDevice BLE;
@@ -0,0 +1,11 @@
+/*
+ * RTCZero.h
+ *
+ * Host stub, NtpRtc only holds an instance. The tests implement NtpRtc itself.
+ */ 
+
+#pragma once
+
+class RTCZero
+{
+};
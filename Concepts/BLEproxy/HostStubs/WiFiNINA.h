@@ -0,0 +1,14 @@
+/*
+ * WiFiNINA.h
+ *
+ * Host stub, AprsWebClient only holds a WiFiClient. The tests implement AprsWebClient itself.
+ */ 
+
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+
+class WiFiClient
+{
+};
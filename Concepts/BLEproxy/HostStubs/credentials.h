@@ -0,0 +1,9 @@
+/*
+ * credentials.h
+ *
+ * Host stub, used unless a real credentials.h sits next to the sources (see credentials_template.h).
+ */ 
+
+#pragma once
+
+#define SHELLY_BLUHT_BINDKEY		nullptr
@@ -0,0 +1,138 @@
+#include "RadioCoexistence.h"
+#include "deviceconfig.h"
+#include "NtpRtc.h"
+#include <ArduinoBLE.h>
+
+RadioCoexistence::RadioCoexistence(BleSensorTable& sensorTable, BleScanScheduler& scanScheduler, AprsWebClient& aprsClient)
+	: mSensorTable(sensorTable)
+	, mScanScheduler(scanScheduler)
+	, mAprsClient(aprsClient)
+	, mPendingCount(0)
+	, mFirstPendingMs(0)
+	, mHoldOffMs(0)
+	, mWindowMs(initialWindowMs)
+	, mWindows(0)
+	, mUploads(0)
+	, mFailedUploads(0)
+	, mSharedUploads(0)
+	, mBleRestartMs(0)
+{
+}
+
+void RadioCoexistence::QueueUpload(BleSensor& sensor)
+{
+	// Missing values would be sent as 0
+	const BtHomeData& data = sensor.parser.GetData();
+	if (!data.Has(BtHomeField::Temperature) || !data.Has(BtHomeField::Humidity))
+	{
+		DebugTRACE("Temperature or humidity missing, not queued\n");
+		return;
+	}
+
+	// A sensor sending again before its upload succeeded (the send interval starts then) replaces its queued data
+	if (!sensor.uploadPending)
+	{
+		sensor.uploadPending = true;
+		if (mPendingCount++ == 0)
+		{
+			mFirstPendingMs = millis();
+			mHoldOffMs = 0;
+		}
+	}
+	sensor.uploadData = data;
+}
+
+bool RadioCoexistence::Update()
+{
+	if (mPendingCount == 0)
+	{
+		return true;
+	}
+
+	const unsigned long nowMs = millis();
+	const unsigned long pendingMs = nowMs - mFirstPendingMs;
+	if (pendingMs < mHoldOffMs)
+	{
+		return true;	// Retry of failed uploads
+	}
+	if (!IsWindowFree(nowMs, mWindowMs) && (pendingMs - mHoldOffMs < maxDeferralMs))
+	{
+		return true;
+	}
+
+	return RunWindow();
+}
+
+bool RadioCoexistence::IsWindowFree(const unsigned long nowMs, const unsigned long durationMs)
+{
+	// Sensors without prediction are scanned continuously, any window costs packets of them
+	bool free = true;
+	mSensorTable.ForEach([&](BleSensor& sensor)
+	{
+		free &= !sensor.predictor.IsPacketExpectedWithin(nowMs, durationMs);
+	});
+	return free;
+}
+
+bool RadioCoexistence::RunWindow()
+{
+	const unsigned long startMs = millis();
+
+	// The NINA firmware runs either the BLE (HCI) or the WiFi stack, BLE has to be shut down for every window
+	mScanScheduler.Stop();
+	BLE.end();
+	unsigned long bleRestartMs = millis() - startMs;
+
+	unsigned char uploads = 0;
+	unsigned char failedUploads = 0;
+	mSensorTable.ForEach([&](BleSensor& sensor)
+	{
+		if (!sensor.uploadPending)
+		{
+			return;
+		}
+		DebugTRACE("Forwarding "); DebugPRINTLN(sensor.config->address);
+		if (!mAprsClient.SendWeatherReportPacket(
+			sensor.config->aprsObjectName,
+			sensor.uploadData.humidity,
+			sensor.uploadData.temperature,
+			sensor.uploadData.batteryLevel))
+		{
+			DebugTRACE("Upload failed, kept for the next window\n");
+			failedUploads++;
+			return;
+		}
+		sensor.uploadPending = false;
+		sensor.lastSendTime = NtpRtc::instance()->GetTime();
+		uploads++;
+	});
+
+	// Failed uploads stay queued, the next window opens retryDelayMs later at the earliest
+	mPendingCount = failedUploads;
+	mFirstPendingMs = millis();
+	mHoldOffMs = retryDelayMs;
+	mUploads += uploads;
+	mFailedUploads += failedUploads;
+	mSharedUploads += (uploads > 1) ? uploads - 1 : 0;
+
+	// Scanning is restarted by the scan scheduler
+	const unsigned long beginMs = millis();
+	const bool bleStarted = BLE.begin();
+	bleRestartMs += millis() - beginMs;
+
+	mWindows++;
+	mBleRestartMs += bleRestartMs;
+	mWindowMs = millis() - startMs;
+	Report();
+
+	return bleStarted;
+}
+
+void RadioCoexistence::Report() const
+{
+	// Every further successful upload in a shared window saved one BLE restart
+	const unsigned long averageRestartMs = mBleRestartMs / mWindows;
+	DebugTRACE("WiFi windows: "); DebugPRINT(mWindows); DebugPRINT(", uploads: "); DebugPRINT(mUploads); DebugPRINT(", failed: "); DebugPRINT(mFailedUploads);
+	DebugPRINT(", window [ms]: "); DebugPRINT(mWindowMs); DebugPRINT(", BLE restart [ms]: "); DebugPRINT(averageRestartMs);
+	DebugPRINT(", saved [ms]: "); DebugPRINTLN(mSharedUploads * averageRestartMs);
+}
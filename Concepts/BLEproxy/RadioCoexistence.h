@@ -0,0 +1,43 @@
+#pragma once
+
+#include "AprsWebClient.h"
+#include "BleScanScheduler.h"
+#include "BleSensorTable.h"
+
+/// @brief Shares the NINA module between BLE and WiFi: uploads are queued and sent in WiFi windows between the predicted advertisements
+class RadioCoexistence
+{
+	/// @brief Initial estimate in [ms] of a WiFi window (BLE.end(), WiFi connect, upload, BLE.begin()), replaced by measurements
+	static constexpr auto initialWindowMs =	15000UL;
+	/// @brief Longest time in [ms] an upload waits for a gap between the advertisements of the other sensors
+	static constexpr auto maxDeferralMs =	(2UL * 60 * 1000);
+	/// @brief Time in [ms] before failed uploads are tried again (e.g. WiFi down, every window costs a BLE restart)
+	static constexpr auto retryDelayMs =	(60UL * 1000);
+
+public:
+	RadioCoexistence(BleSensorTable& sensorTable, BleScanScheduler& scanScheduler, AprsWebClient& aprsClient);
+
+	/// @brief Send the current data of the sensor in the next WiFi window, ignored unless it contains temperature and humidity
+	/// The send interval of the sensor (lastSendTime) starts once the upload succeeded, failed uploads stay queued
+	void QueueUpload(BleSensor& sensor);
+	/// @brief Open a WiFi window once no advertisement is expected during it, call from loop()
+	bool Update();
+
+private:
+	bool IsWindowFree(const unsigned long nowMs, const unsigned long durationMs);
+	bool RunWindow();
+	void Report() const;
+
+	BleSensorTable& mSensorTable;
+	BleScanScheduler& mScanScheduler;
+	AprsWebClient& mAprsClient;
+	unsigned char mPendingCount;
+	unsigned long mFirstPendingMs;
+	unsigned long mHoldOffMs;			// No window before mFirstPendingMs + mHoldOffMs, the deferral limit starts then
+	unsigned long mWindowMs;			// Duration of the last window
+	unsigned long mWindows;
+	unsigned long mUploads;				// Successful
+	unsigned long mFailedUploads;
+	unsigned long mSharedUploads;		// Successful uploads besides the first one of their window
+	unsigned long mBleRestartMs;		// Accumulated BLE.end() + BLE.begin() time
+};
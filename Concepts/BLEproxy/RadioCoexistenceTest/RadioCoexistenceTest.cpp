@@ -0,0 +1,242 @@
+/*
+ * RadioCoexistenceTest.cpp
+ *
+ * Host test of the WiFi window scheduling (RadioCoexistence): uploads wait for a gap between the predicted
+ * advertisements, at most maxDeferralMs, queued sensors share one window and failed uploads stay queued.
+ * Build: g++ -std=c++17 -O2 -I../HostStubs -o RadioCoexistenceTest RadioCoexistenceTest.cpp ../BleAdvertisementParser.cpp ../BtHomeObjects.cpp ../BtHomeCrypto.cpp
+ *        (the sources are included, ArduinoBLE, millis(), NtpRtc and the APRS upload are simulated, see ../HostStubs)
+ * Usage: RadioCoexistenceTest	(exit code 0 if all scenarios pass)
+ */ 
+
+#include <cstdio>
+
+#define BLE_SENSORS { \
+	{ "7c:c6:b6:61:e3:a0", 0, nullptr, nullptr }, \
+	{ "7c:c6:b6:61:e3:a1", 0, "SHELLY2", nullptr }, \
+}
+
+#include "../BleSensorTable.cpp"
+#include "../BleAdvertisementPredictor.cpp"
+#include "../BleScanScheduler.cpp"
+#include "../RadioCoexistence.cpp"
+
+#define STEP_MS						100
+#define PERIOD_MS					60000UL
+#define MAX_DEFERRAL_MS				(2UL * 60 * 1000)	/* As in RadioCoexistence.h */
+#define RETRY_DELAY_MS				(60UL * 1000)
+#define BLE_END_MS					1000	/* Simulated durations within a window */
+#define BLE_BEGIN_MS				2000
+#define UPLOAD_MS					8000
+
+BLELocalDevice BLE;
+
+static unsigned long simMs;
+static unsigned char simBleRestarts;		// BLE.end() calls
+static unsigned long simWindowMs;			// Start of the last window
+static bool simUploadFails;
+static unsigned char simUploads;			// SendWeatherReportPacket() calls
+static short simUploadedTemperature;
+
+unsigned long millis()
+{
+	return simMs;
+}
+
+int BLELocalDevice::begin()
+{
+	simMs += BLE_BEGIN_MS;
+	return 1;
+}
+
+void BLELocalDevice::end()
+{
+	simBleRestarts++;
+	simWindowMs = simMs;
+	simMs += BLE_END_MS;
+}
+
+int BLELocalDevice::scan(bool)
+{
+	return 1;
+}
+
+void BLELocalDevice::stopScan()
+{
+}
+
+NtpRtc::NtpRtc()
+	: mLastNtpSync(0)
+{
+}
+
+NtpRtc* NtpRtc::instance()
+{
+	static NtpRtc ntpRtc;
+	return &ntpRtc;
+}
+
+time_t NtpRtc::GetTime()
+{
+	return 1700000000 + simMs / 1000;
+}
+
+bool AprsWebClient::SendWeatherReportPacket(const char*, unsigned char, const short temperature, unsigned char)
+{
+	simUploads++;
+	simUploadedTemperature = temperature;
+	simMs += UPLOAD_MS;
+	return !simUploadFails;
+}
+
+
+/// @brief Proxy with two sensors, the first one advertising every minute
+class Proxy
+{
+public:
+	Proxy()
+		: mScheduler(mTable)
+		, mCoexistence(mTable, mScheduler, mAprsClient)
+		, mFirst(mTable.Find("7c:c6:b6:61:e3:a0"))
+		, mSecond(mTable.Find("7c:c6:b6:61:e3:a1"))
+		, mPacketId(0)
+	{
+		simMs = 0;
+		simBleRestarts = 0;
+		simUploadFails = false;
+		simUploads = 0;
+	}
+
+	/// @brief Packet of a sensor as accepted in loop()
+	void Receive(BleSensor& sensor, const short temperature)
+	{
+		const unsigned char packet[] = { 0x02, 0x01, 0x06, 0x0D, 0x16, 0xD2, 0xFC, 0x44, 0x00, ++mPacketId, 0x01, 0x64, 0x2E, 0x24,
+			0x45, static_cast<unsigned char>(temperature), static_cast<unsigned char>(temperature >> 8) };
+		if (sensor.parser.FetchBleData(packet, sizeof(packet)))
+		{
+			sensor.predictor.OnPacket(simMs);
+			if (sensor.IsSendingDue(NtpRtc::instance()->GetTime()))
+			{
+				mCoexistence.QueueUpload(sensor);
+			}
+		}
+	}
+
+	/// @brief Lock the prediction of the first sensor (packets seen by the scanner only, nothing queued),
+	/// its next packet is expected PERIOD_MS after the current time
+	void Lock()
+	{
+		for (unsigned char i = 0; i < 4; i++)
+		{
+			simMs += i ? PERIOD_MS : 0;
+			mFirst->predictor.OnPacket(simMs);
+		}
+	}
+
+	/// @brief Call Update() as loop() does, true if a window opened (stops there unless untilWindow is false)
+	bool Run(const unsigned long durationMs, const bool untilWindow = true)
+	{
+		const unsigned char restarts = simBleRestarts;
+		for (unsigned long elapsedMs = 0; elapsedMs < durationMs; elapsedMs += STEP_MS, simMs += STEP_MS)
+		{
+			mCoexistence.Update();
+			if (untilWindow && simBleRestarts != restarts)
+			{
+				return true;
+			}
+		}
+		return simBleRestarts != restarts;
+	}
+
+	BleSensorTable mTable;
+	BleScanScheduler mScheduler;
+	AprsWebClient mAprsClient;
+	RadioCoexistence mCoexistence;
+	BleSensor* mFirst;
+	BleSensor* mSecond;
+
+private:
+	unsigned char mPacketId;
+};
+
+
+static int failures;
+
+static void Check(const bool condition, const char* scenario, const char* message)
+{
+	if (!condition)
+	{
+		printf("%s: FAILED, %s\n", scenario, message);
+		failures++;
+	}
+}
+
+
+static void TestDeferral()
+{
+	Proxy proxy;
+	proxy.Lock();
+
+	// 10 s before the next packet of the first sensor, the window (about 11 s) does not fit before it
+	proxy.Run(PERIOD_MS - 10000, false);
+	const unsigned long queuedMs = simMs;
+	proxy.Receive(*proxy.mSecond, 210);
+	Check(!proxy.Run(9000), "deferral", "window opened before the expected packet");
+
+	// The packet also queues the upload of the first sensor, both are sent in the window opening right after it
+	proxy.Receive(*proxy.mFirst, 220);
+	Check(proxy.Run(STEP_MS), "deferral", "no window right after the expected packet");
+	Check(simUploads == 2 && simBleRestarts == 1, "deferral", "uploads not sent in one window");
+	printf("deferral: window %lu s after queueing, %u uploads in %u window\n", (simWindowMs - queuedMs) / 1000, simUploads, simBleRestarts);
+}
+
+
+static void TestDeferralLimit()
+{
+	Proxy proxy;
+	proxy.Lock();
+	proxy.Run(PERIOD_MS - 10000, false);
+
+	// The first sensor falls silent, its stale prediction keeps blocking the window (the scheduler does not run here)
+	const unsigned long queuedMs = simMs;
+	proxy.Receive(*proxy.mSecond, 250);
+	Check(proxy.Run(3 * PERIOD_MS), "deferral limit", "no window at all");
+	const unsigned long deferredMs = simWindowMs - queuedMs;
+	Check(deferredMs >= MAX_DEFERRAL_MS && deferredMs <= MAX_DEFERRAL_MS + STEP_MS,
+		"deferral limit", "window not opened at the limit");
+	printf("deferral limit: window after %lu s\n", deferredMs / 1000);
+}
+
+
+static void TestFailedUpload()
+{
+	Proxy proxy;
+	simUploadFails = true;
+	proxy.Receive(*proxy.mSecond, 260);
+	Check(proxy.Run(1000), "failed upload", "no window");
+	Check(proxy.mSecond->uploadPending, "failed upload", "failed upload dropped");
+	Check(proxy.mSecond->IsSendingDue(NtpRtc::instance()->GetTime()), "failed upload", "send interval started without an upload");
+
+	// Newer data replaces the queued one, the retry waits retryDelayMs
+	proxy.Run(10000);
+	proxy.Receive(*proxy.mSecond, 270);
+	simUploadFails = false;
+	const unsigned long failedMs = simWindowMs;
+	Check(proxy.Run(2 * PERIOD_MS), "failed upload", "not retried");
+	Check(simWindowMs - failedMs >= RETRY_DELAY_MS, "failed upload", "retried too early");
+	Check(simUploads == 2 && simUploadedTemperature == 270, "failed upload", "retry did not send the latest data");
+	Check(!proxy.mSecond->uploadPending, "failed upload", "still queued after the upload");
+	Check(!proxy.mSecond->IsSendingDue(NtpRtc::instance()->GetTime()), "failed upload", "send interval not started");
+	Check(!proxy.Run(2 * PERIOD_MS), "failed upload", "window without pending uploads");
+	printf("failed upload: retried after %lu s\n", (simWindowMs - failedMs) / 1000);
+}
+
+
+int main()
+{
+	TestDeferral();
+	TestDeferralLimit();
+	TestFailedUpload();
+
+	printf(failures ? "FAILED\n" : "passed\n");
+	return failures ? 1 : 0;
+}
@@ -5,3 +5,5 @@
 
 #define APRS_CALLSIGN				""		/* your APRS callsign & SSID */
 #define APRS_PASSCODE				0		/* your APRS passcode */
+
+#define SHELLY_BLUHT_BINDKEY		nullptr	/* BTHome encryption key of the sensor as 32 hex digits, e.g. "231d39c1d7cc1ab1aee224cd096db932", nullptr if unencrypted */
@@ -1,19 +1,20 @@
 #pragma once
 
 #define _DEBUG_TRACE_
+//#define _DEBUG_TRACE_RAW_						/* Additionally dump every received advertisement in hex (slow) */
 
 #define STRINGIFY(_s)				STRGFY(_s)
 #define STRGFY(_s)					#_s
 #define TOBOOL(_b)					_b ? "true" : "false"
 
-#ifdef _DEBUG_TRACE_
+#if defined(_DEBUG_TRACE_) && defined(ARDUINO)		/* No Serial in host builds */
   #define DebugPRINT				Serial.print
   #define DebugPRINTLN				Serial.println
   #define DebugTRACE(_message)		{ Serial.print("("); Serial.print(__FUNCTION__); Serial.print(" L"); Serial.print(__LINE__); Serial.print(") "); Serial.print(_message); }
 #else
-  #define DebugPRINT
-  #define DebugPRINTLN
-  #define DebugTRACE
+  #define DebugPRINT(...)
+  #define DebugPRINTLN(...)
+  #define DebugTRACE(...)
 #endif
 
 // Board: Arduino Nano 33 IoT
@@ -22,6 +23,13 @@
 
 #define SHELLY_BLUHT_ADDRESS		"7c:c6:b6:61:e3:a0"
 
+/* Sensors to forward: { MAC, Bresser channel [ 1..3, 0 = none ], APRS object name [ max. 9 characters, nullptr = weather report of this station ], bind key (see credentials.h) } */
+#ifndef BLE_SENSORS						/* Host tests bring their own */
+#define BLE_SENSORS { \
+	{ SHELLY_BLUHT_ADDRESS, 0, nullptr, SHELLY_BLUHT_BINDKEY }, \
+}
+#endif
+
 #define PWR_LED_PIN					12			/* Re-pinned */
 #define USER_LED_PIN				13			/* Default */
 
@@ -0,0 +1,193 @@
+#include "BresserBurst.h"
+#include <string.h>
+
+#define SENDER_CHANNEL_MASK				0x30	/* Channel bits in the 2nd byte */
+
+
+void bresserBurstInit(BresserBurst_t *burst, uint32_t gap)
+{
+	memset(burst, 0, sizeof(*burst));
+	burst->gap = gap;
+}
+
+
+static bool vote(const BresserBurstSlot_t *slot, BresserBurstResult_t *result)
+{
+	BresserFrame_t voted;
+	uint8_t count = slot->count;
+	
+	memset(&voted, 0, sizeof(voted));
+	for (uint8_t bit = 0; bit < BRESSER_DATA_BITS; ++bit)
+	{
+		uint8_t mask = 0x80 >> (bit & 7);
+		uint8_t ones = 0;
+		for (uint8_t i = 0; i < count; ++i)
+		{
+			if (slot->frames[i].data[bit >> 3] & mask)
+			{
+				++ones;
+			}
+		}
+		if (2 * ones > count)
+		{
+			voted.data[bit >> 3] |= mask;
+		}
+	}
+	
+	if (!bresserFrameDecode(&voted, &result->record))
+	{
+		/* Ties (even number of copies) may break the vote - fall back to any valid copy */
+		uint8_t i = 0;
+		while (i < count && !bresserFrameDecode(&slot->frames[i], &result->record))
+		{
+			++i;
+		}
+		if (i == count)
+		{
+			return false;
+		}
+		voted = slot->frames[i];
+	}
+	
+	uint32_t bitPeriodSum = 0;
+	result->copies = count;
+	result->agreeing = 0;
+	for (uint8_t i = 0; i < count; ++i)
+	{
+		if (memcmp(slot->frames[i].data, voted.data, sizeof(voted.data)) == 0)
+		{
+			++result->agreeing;
+		}
+		bitPeriodSum += slot->frames[i].bitPeriod;
+	}
+	result->bitPeriod = bitPeriodSum / count;
+	return true;
+}
+
+
+static bool complete(BresserBurstSlot_t *slot, BresserBurstResult_t *result)
+{
+	bool valid = (slot->count > 0 && !slot->done && vote(slot, result));
+	slot->done = true;
+	return valid;
+}
+
+
+static void release(BresserBurstSlot_t *slot)
+{
+	slot->count = 0;
+	slot->done = false;
+}
+
+
+static bool isExpired(const BresserBurst_t *burst, const BresserBurstSlot_t *slot, uint32_t time)
+{
+	return slot->count > 0 && (uint32_t)(time - slot->lastTime) > burst->gap;
+}
+
+
+static bool isSameSender(const BresserFrame_t *a, const BresserFrame_t *b)
+{
+	return a->data[0] == b->data[0] && ((a->data[1] ^ b->data[1]) & SENDER_CHANNEL_MASK) == 0;
+}
+
+
+bool bresserBurstFrame(BresserBurst_t *burst, const BresserFrame_t *frame, uint32_t time, BresserBurstResult_t *result)
+{
+	BresserBurstSlot_t *slot = NULL;
+	BresserBurstSlot_t *oldest = NULL;
+	bool completed = false;
+	
+	for (uint8_t i = 0; i < BRESSER_BURST_SLOTS; ++i)
+	{
+		BresserBurstSlot_t *candidate = &burst->slots[i];
+		if (candidate->count > 0 && isSameSender(&candidate->frames[0], frame))
+		{
+			slot = candidate;
+			break;
+		}
+		if (candidate->count == 0)
+		{
+			if (!oldest || oldest->count > 0)
+			{
+				oldest = candidate;
+			}
+		}
+		else if (!oldest || (oldest->count > 0 && (uint32_t)(time - candidate->lastTime) > (uint32_t)(time - oldest->lastTime)))
+		{
+			oldest = candidate;
+		}
+	}
+	
+	if (slot)
+	{
+		if (isExpired(burst, slot, time))
+		{
+			/* Next burst of the same sender */
+			completed = complete(slot, result);
+			release(slot);
+		}
+	}
+	else
+	{
+		/* New sender: a free slot, otherwise the one silent for the longest time is completed early */
+		slot = oldest;
+		if (slot->count > 0)
+		{
+			completed = complete(slot, result);
+			release(slot);
+		}
+	}
+	slot->lastTime = time;
+	
+	if (slot->done || slot->count >= BRESSER_BURST_COPIES)
+	{
+		/* Duplicate of an already emitted burst */
+		return completed;
+	}
+	
+	slot->frames[slot->count++] = *frame;
+	if (slot->count == BRESSER_BURST_COPIES && !completed)
+	{
+		completed = complete(slot, result);
+	}
+	return completed;
+}
+
+
+bool bresserBurstPoll(BresserBurst_t *burst, uint32_t time, BresserBurstResult_t *result)
+{
+	for (uint8_t i = 0; i < BRESSER_BURST_SLOTS; ++i)
+	{
+		BresserBurstSlot_t *slot = &burst->slots[i];
+		if (isExpired(burst, slot, time))
+		{
+			bool completed = complete(slot, result);
+			release(slot);
+			if (completed)
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+
+bool bresserBurstFinish(BresserBurst_t *burst, BresserBurstResult_t *result)
+{
+	for (uint8_t i = 0; i < BRESSER_BURST_SLOTS; ++i)
+	{
+		BresserBurstSlot_t *slot = &burst->slots[i];
+		if (slot->count > 0)
+		{
+			bool completed = complete(slot, result);
+			release(slot);
+			if (completed)
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
@@ -0,0 +1,77 @@
+#ifndef _BRESSER_BURST_H_
+#define _BRESSER_BURST_H_
+
+/*
+ * Burst assembly for the Bresser protocol: the transmitter repeats each frame PACKET_COUNT times.
+ * All copies of a burst are collected and combined by bitwise majority vote, which recovers
+ * frames even if no single copy has a valid checksum. Exactly one record is emitted per burst.
+ *
+ * Time is in arbitrary caller units (e.g. microseconds of pulse duration, or milliseconds),
+ * differences are evaluated modulo 2^32.
+ * Interleaved bursts of several sensors are separated by the sender (id and channel bits of each copy),
+ * every sender gets its own vote slot. A copy with a bit error in these bits ends up in a slot of its own
+ * and is dropped with it unless it is the only one of its burst.
+ */
+
+#include "BresserDecoder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BRESSER_BURST_COPIES			15		/* Frames per burst (PACKET_COUNT) */
+#define BRESSER_BURST_GAP_MS			200		/* Frames are ~37 ms apart, a longer silence ends the burst */
+
+#ifndef BRESSER_BURST_SLOTS
+#  ifdef __AVR__
+#    define BRESSER_BURST_SLOTS			3		/* ~128 bytes each */
+#  else
+#    define BRESSER_BURST_SLOTS			8		/* Senders with overlapping bursts */
+#  endif
+#endif
+
+
+typedef struct
+{
+	BresserRecord_t record;
+	uint8_t copies;				/* Frames received */
+	uint8_t agreeing;			/* Frames identical to the voted result */
+	uint16_t bitPeriod;			/* Average measured bit period [ticks] */
+} BresserBurstResult_t;
+
+
+typedef struct
+{
+	uint32_t lastTime;
+	uint8_t count;				/* 0 = unused */
+	bool done;					/* Result emitted, further copies are duplicates */
+	BresserFrame_t frames[BRESSER_BURST_COPIES];
+} BresserBurstSlot_t;
+
+
+typedef struct
+{
+	uint32_t gap;
+	BresserBurstSlot_t slots[BRESSER_BURST_SLOTS];
+} BresserBurst_t;
+
+
+/*! gap: silence [caller time units] after which a burst is complete, e.g. BRESSER_BURST_GAP_MS converted. */
+void bresserBurstInit(BresserBurst_t *burst, uint32_t gap);
+
+/*! Add a received frame (checksum not required). Returns true and fills result when a burst completed:
+ *  the previous one of the same sender (gap), this one (all copies received) or, with all slots in use,
+ *  the least recently updated one of another sender. */
+bool bresserBurstFrame(BresserBurst_t *burst, const BresserFrame_t *frame, uint32_t time, BresserBurstResult_t *result);
+
+/*! Call periodically: completes a pending burst once its gap has elapsed, one per call. */
+bool bresserBurstPoll(BresserBurst_t *burst, uint32_t time, BresserBurstResult_t *result);
+
+/*! Complete the pending bursts now (e.g. end of input), one per call - repeat until false. */
+bool bresserBurstFinish(BresserBurst_t *burst, BresserBurstResult_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BRESSER_BURST_H_ */
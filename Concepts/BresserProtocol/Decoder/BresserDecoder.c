@@ -0,0 +1,151 @@
+#include "BresserDecoder.h"
+#include <string.h>
+
+
+static void setThresholds(BresserDecoder_t *decoder, uint16_t bitPeriod)
+{
+	uint16_t t = bitPeriod / 3;
+	
+	decoder->bitPeriod = bitPeriod;
+	decoder->glitchMax = t / 2;
+	decoder->shortMax = t + t / 2;
+	decoder->dataMax = 2 * t + t / 2;
+}
+
+
+void bresserDecoderInit(BresserDecoder_t *decoder, uint16_t bitPeriod)
+{
+	uint16_t t = bitPeriod / 3;
+	
+	/* 3T preamble phases, not overlapping with 2T of a nominal sender */
+	decoder->searchMin = 2 * t + t / 5;
+	decoder->searchMax = 4 * t;
+	bresserDecoderReset(decoder);
+}
+
+
+void bresserDecoderReset(BresserDecoder_t *decoder)
+{
+	decoder->preambleCount = 0;
+	decoder->preambleSum = 0;
+	decoder->bitCount = 0;
+	decoder->expectHigh = false;
+}
+
+
+/* Returns true if the pulse is a candidate preamble phase */
+static bool searchPreamble(BresserDecoder_t *decoder, uint8_t level, uint16_t duration)
+{
+	if (duration <= decoder->searchMin || duration > decoder->searchMax)
+	{
+		bresserDecoderReset(decoder);
+		return false;
+	}
+	
+	/* All phases of one preamble have the same length - restart on a deviation > 1/4 of the average so far,
+	 * e.g. the preceding 2T data pulse of a slow sender which still fits into the search window */
+	uint32_t expected = decoder->preambleSum;
+	uint32_t actual = (uint32_t)duration * decoder->preambleCount;
+	if ((actual > expected ? actual - expected : expected - actual) > expected / 4)
+	{
+		decoder->preambleCount = 0;
+		decoder->preambleSum = 0;
+	}
+	
+	if (decoder->preambleCount < 0xFF)
+	{
+		++decoder->preambleCount;
+		decoder->preambleSum += duration;
+	}
+	decoder->expectHigh = (level == 0);
+	return true;
+}
+
+
+bool bresserDecoderPulse(BresserDecoder_t *decoder, uint8_t level, uint16_t duration, BresserFrame_t *frame)
+{
+	if (decoder->bitCount == 0)
+	{
+		/* Preamble or first data bit */
+		if (decoder->preambleCount < BRESSER_PREAMBLE_MIN || level == 0 || !decoder->expectHigh)
+		{
+			searchPreamble(decoder, level, duration);
+			return false;
+		}
+		
+		/* Calibrate on the preamble: each phase is one bit period */
+		setThresholds(decoder, decoder->preambleSum / decoder->preambleCount);
+		if (duration > decoder->dataMax)
+		{
+			searchPreamble(decoder, level, duration);
+			return false;
+		}
+		if (duration <= decoder->glitchMax)
+		{
+			bresserDecoderReset(decoder);
+			return false;
+		}
+		memset(decoder->data, 0, sizeof(decoder->data));
+	}
+	else
+	{
+		if (duration > decoder->dataMax)
+		{
+			/* Preamble of the next packet, idle or garbage */
+			bresserDecoderReset(decoder);
+			searchPreamble(decoder, level, duration);
+			return false;
+		}
+		if (duration <= decoder->glitchMax || (level != 0) != decoder->expectHigh)
+		{
+			/* Noise or lost an edge */
+			bresserDecoderReset(decoder);
+			return false;
+		}
+		if (level == 0)
+		{
+			/* Gap after a data bit, carries no information */
+			decoder->expectHigh = true;
+			return false;
+		}
+	}
+	
+	if (duration > decoder->shortMax)
+	{
+		decoder->data[decoder->bitCount >> 3] |= (0x80 >> (decoder->bitCount & 7));
+	}
+	++decoder->bitCount;
+	decoder->expectHigh = false;
+	
+	if (decoder->bitCount < BRESSER_DATA_BITS)
+	{
+		return false;
+	}
+	
+	memcpy(frame->data, decoder->data, sizeof(frame->data));
+	frame->bitPeriod = decoder->bitPeriod;
+	bresserDecoderReset(decoder);
+	return true;
+}
+
+
+bool bresserFrameDecode(const BresserFrame_t *frame, BresserRecord_t *record)
+{
+	const uint8_t *data = frame->data;
+	
+	if ((uint8_t)(data[0] + data[1] + data[2] + data[3]) != data[4])
+	{
+		return false;
+	}
+	
+	/* Raw value is degF * 10 + 900 */
+	int16_t fahrenheit = (int16_t)(((data[1] & 0xF) << 8) | data[2]) - 900;
+	
+	record->id = data[0];
+	record->batteryLow = (data[1] >> 7) & 0x1;
+	record->test = (data[1] >> 6) & 0x1;
+	record->channel = (data[1] >> 4) & 0x3;
+	record->temperature = (fahrenheit - 320) * 10 / 18;
+	record->humidity = data[3];
+	return true;
+}
@@ -0,0 +1,90 @@
+#ifndef _BRESSER_DECODER_H_
+#define _BRESSER_DECODER_H_
+
+/*
+ * Streaming decoder for the Bresser 3-channel protocol (see Transmitter/main_simpletimer.c).
+ * Plain C99 without dependencies - shared by the AVR receiver and the Linux tools.
+ *
+ * Input is a stream of (level, duration) pulses, duration in arbitrary ticks
+ * (e.g. microseconds), saturated at 0xFFFF by the caller.
+ *
+ * Packet on air, T = bit period / 3 (250 us nominal):
+ *   Preamble  8 alternating phases of 3T (high, low, high, ...)
+ *   0 bit     high T, low 2T
+ *   1 bit     high 2T, low T
+ *   41 data bits, MSB first: id, flags/temperature, temperature, humidity, checksum, 1 padding bit
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BRESSER_DATA_BITS				41
+#define BRESSER_PREAMBLE_BITS			8
+#define BRESSER_FRAME_BYTES				((BRESSER_DATA_BITS + 7) / 8)
+#define BRESSER_BIT_PERIOD_US			750
+#define BRESSER_PREAMBLE_MIN			6		/* Preamble phases required before data, the first ones may be lost while the receiver settles */
+
+
+typedef struct
+{
+	uint8_t data[BRESSER_FRAME_BYTES];
+	uint16_t bitPeriod;			/* Measured from the preamble [ticks] */
+} BresserFrame_t;
+
+
+typedef struct
+{
+	uint8_t id;
+	uint8_t batteryLow;
+	uint8_t test;
+	uint8_t channel;
+	int16_t temperature;		/* 0.1 degC */
+	uint8_t humidity;			/* % */
+} BresserRecord_t;
+
+
+typedef struct
+{
+	/* Preamble search window [ticks], from the nominal bit period */
+	uint16_t searchMin;
+	uint16_t searchMax;
+	
+	/* Pulse classification thresholds [ticks], from the bit period measured on the preamble */
+	uint16_t glitchMax;			/* Shorter pulses are noise */
+	uint16_t shortMax;			/* T vs. 2T */
+	uint16_t dataMax;			/* 2T vs. preamble 3T */
+	
+	/* Stream state */
+	uint8_t preambleCount;
+	uint32_t preambleSum;
+	uint16_t bitPeriod;
+	uint8_t bitCount;
+	bool expectHigh;
+	uint8_t data[BRESSER_FRAME_BYTES];
+} BresserDecoder_t;
+
+
+/*! Set up for the nominal bit period [ticks], e.g. BRESSER_BIT_PERIOD_US for microseconds.
+ *  Each packet is decoded with the bit period measured on its own preamble (each phase is one bit period),
+ *  so sender clocks may deviate by about +-25 % from nominal. */
+void bresserDecoderInit(BresserDecoder_t *decoder, uint16_t bitPeriod);
+
+/*! Drop any partially received frame. */
+void bresserDecoderReset(BresserDecoder_t *decoder);
+
+/*! Feed one pulse. Returns true and fills frame when the last data bit was received.
+ *  Frames are returned regardless of their checksum, see bresserFrameDecode(). */
+bool bresserDecoderPulse(BresserDecoder_t *decoder, uint8_t level, uint16_t duration, BresserFrame_t *frame);
+
+/*! Checksum verification and field extraction. Returns false on checksum mismatch (record untouched). */
+bool bresserFrameDecode(const BresserFrame_t *frame, BresserRecord_t *record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BRESSER_DECODER_H_ */
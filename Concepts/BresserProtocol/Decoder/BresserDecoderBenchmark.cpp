@@ -0,0 +1,112 @@
+/*
+ * BresserDecoderBenchmark.cpp
+ *
+ * Host throughput of the streaming decoder and the burst vote, in pulses per second (google-benchmark).
+ * Build: g++ -O2 -o BresserDecoderBenchmark BresserDecoderBenchmark.cpp BresserDecoder.c BresserBurst.c -lbenchmark -lpthread
+ * Usage: BresserDecoderBenchmark [--benchmark_filter=...]
+ *
+ * Input is a synthetic capture of 64 bursts (different senders, +-20 us jitter, every 7th copy with a bit error),
+ * about 55 s on air. A transmitting sensor produces about 2.5 k pulses per second.
+ */ 
+
+#include <cstdint>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "BresserDecoder.h"
+#include "BresserBurst.h"
+#include "SyntheticCapture.h"
+
+#define BENCHMARK_BURSTS		64
+
+
+static const SyntheticCapture& capture()
+{
+	static SyntheticCapture capture;
+	
+	if (capture.pulses().empty())
+	{
+		unsigned copy = 0;
+		for (unsigned i = 0; i < BENCHMARK_BURSTS; ++i)
+		{
+			SyntheticSender sender = { (uint8_t)(i * 37), (uint8_t)(1 + i % 3), (int16_t)(200 + i * 11), (uint8_t)(20 + i) };
+			for (uint8_t c = 0; c < BRESSER_BURST_COPIES; ++c, ++copy)
+			{
+				capture.copy(sender.frame(), (copy % 7) == 0 ? rand() % BRESSER_DATA_BITS : -1);
+			}
+			capture.silence(300000);
+		}
+	}
+	return capture;
+}
+
+
+static void BM_DecoderPulses(benchmark::State& state)
+{
+	const std::vector<SyntheticCapture::Pulse>& pulses = capture().pulses();
+	BresserDecoder_t decoder;
+	BresserFrame_t frame;
+	int64_t frames = 0;
+	
+	bresserDecoderInit(&decoder, BRESSER_BIT_PERIOD_US);
+	for (auto _ : state)
+	{
+		for (const SyntheticCapture::Pulse& pulse : pulses)
+		{
+			frames += bresserDecoderPulse(&decoder, pulse.level, (pulse.durationUs > 0xFFFF) ? 0xFFFF : pulse.durationUs, &frame);
+		}
+		benchmark::DoNotOptimize(frame);
+	}
+	state.SetItemsProcessed(state.iterations() * pulses.size());
+	state.counters["frames"] = benchmark::Counter(frames, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_DecoderPulses);
+
+
+static void BM_DecoderAndBurstPulses(benchmark::State& state)
+{
+	const std::vector<SyntheticCapture::Pulse>& pulses = capture().pulses();
+	BresserDecoder_t decoder;
+	BresserBurst_t burst;
+	BresserFrame_t frame;
+	BresserBurstResult_t result;
+	int64_t records = 0;
+	uint32_t time = 0;
+	
+	bresserDecoderInit(&decoder, BRESSER_BIT_PERIOD_US);
+	bresserBurstInit(&burst, BRESSER_BURST_GAP_MS * 1000UL);
+	for (auto _ : state)
+	{
+		for (const SyntheticCapture::Pulse& pulse : pulses)
+		{
+			time += pulse.durationUs;
+			records += bresserBurstPoll(&burst, time, &result);
+			if (bresserDecoderPulse(&decoder, pulse.level, (pulse.durationUs > 0xFFFF) ? 0xFFFF : pulse.durationUs, &frame))
+			{
+				records += bresserBurstFrame(&burst, &frame, time, &result);
+			}
+		}
+		benchmark::DoNotOptimize(result);
+	}
+	state.SetItemsProcessed(state.iterations() * pulses.size());
+	state.counters["records"] = benchmark::Counter(records, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_DecoderAndBurstPulses);
+
+
+static void BM_FrameDecode(benchmark::State& state)
+{
+	BresserFrame_t frame = SyntheticSender{ 232, 2, 720, 55 }.frame();
+	BresserRecord_t record;
+	
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(bresserFrameDecode(&frame, &record));
+		benchmark::DoNotOptimize(record);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FrameDecode);
+
+
+BENCHMARK_MAIN();
@@ -0,0 +1,155 @@
+/*
+ * BresserPipeline.h
+ *
+ * Host side pulse -> frame -> burst -> record chain shared by the command line tools.
+ */ 
+
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+
+#include "BresserDecoder.h"
+#include "BresserBurst.h"
+#include "BresserSensorTable.h"
+
+#define GATEWAY_DUMP_INTERVAL_US		60000000UL		/* Capture time between sensor table dumps */
+#define GATEWAY_STALE_AGE_MS			600000UL		/* Sensors silent for 10 min may be evicted */
+
+
+class BresserPipeline
+{
+public:
+	enum Output
+	{
+		BURSTS,			// One voted record per burst
+		FRAMES,			// Every received frame
+		GATEWAY			// Sensor table, periodically
+	};
+	
+	explicit BresserPipeline(Output output = BURSTS)
+		: output(output), time(0), lastDump(0), frames(0), checksumErrors(0), bursts(0)
+	{
+		bresserDecoderInit(&decoder, BRESSER_BIT_PERIOD_US);
+		bresserBurstInit(&burst, BRESSER_BURST_GAP_MS * 1000UL);
+		bresserTableInit(&table, GATEWAY_STALE_AGE_MS);
+	}
+	
+	void pulse(uint8_t level, uint32_t durationUs)
+	{
+		BresserFrame_t frame;
+		BresserRecord_t record;
+		BresserBurstResult_t result;
+		
+		time += durationUs;
+		if (bresserBurstPoll(&burst, (uint32_t)time, &result))
+		{
+			printBurst(result);
+		}
+		if (output == GATEWAY && time - lastDump >= GATEWAY_DUMP_INTERVAL_US)
+		{
+			lastDump = time;
+			printTable();
+		}
+		
+		if (!bresserDecoderPulse(&decoder, level, (durationUs > 0xFFFF) ? 0xFFFF : durationUs, &frame))
+		{
+			return;
+		}
+		
+		++frames;
+		bool valid = bresserFrameDecode(&frame, &record);
+		if (!valid)
+		{
+			++checksumErrors;
+		}
+		
+		if (output == FRAMES)
+		{
+			if (valid)
+			{
+				printRecord(record);
+				printf("\n");
+			}
+			else
+			{
+				printf("CHKinv!\n");
+			}
+		}
+		else if (bresserBurstFrame(&burst, &frame, (uint32_t)time, &result))
+		{
+			printBurst(result);
+		}
+	}
+	
+	void finish()
+	{
+		BresserBurstResult_t result;
+		while (bresserBurstFinish(&burst, &result))
+		{
+			printBurst(result);
+		}
+		if (output == GATEWAY)
+		{
+			printTable();
+		}
+		fprintf(stderr, "%u frames, %u checksum errors, %u bursts\n", frames, checksumErrors, bursts);
+	}
+	
+private:
+	// The table works in ms, differences modulo 2^32 stay valid for 49 days
+	uint32_t timeMs() const
+	{
+		return (uint32_t)(time / 1000);
+	}
+	
+	void printRecord(const BresserRecord_t& record)
+	{
+		printf("%u %u %u %u %d %u", record.id, record.batteryLow, record.test, record.channel, record.temperature, record.humidity);
+	}
+	
+	// Sender clock deviation from nominal [%], a slow clock means a longer bit period
+	static double drift(uint16_t bitPeriod)
+	{
+		return 100.0 * ((double)BRESSER_BIT_PERIOD_US / bitPeriod - 1.0);
+	}
+	
+	void printBurst(const BresserBurstResult_t& result)
+	{
+		++bursts;
+		if (output == GATEWAY)
+		{
+			bresserTableUpdate(&table, &result, timeMs());
+			return;
+		}
+		printRecord(result.record);
+		printf(" %u/%u\n", result.copies, result.agreeing);
+	}
+	
+	void printTable()
+	{
+		printf("--- %.0f s: %u sensors, %u evicted\n", time / 1e6, table.count, table.evictions);
+		for (const BresserSensor_t& sensor : table.sensors)
+		{
+			if (!sensor.used)
+			{
+				continue;
+			}
+			printRecord(sensor.last);
+			printf(" age %.0f s, %u bursts, %.1f %% bad frames, clock %+.1f %% (%+.1f .. %+.1f)\n", (uint32_t)(timeMs() - sensor.lastSeen) / 1e3, sensor.bursts,
+				sensor.frames ? 100.0 * sensor.badFrames / sensor.frames : 0.0,
+				drift(sensor.bitPeriod), drift(sensor.bitPeriodMin), drift(sensor.bitPeriodMax));
+		}
+		fflush(stdout);
+	}
+	
+	Output output;
+	uint64_t time;					// Capture time [us], 32 bit would wrap after 71 min
+	uint64_t lastDump;
+	unsigned frames;
+	unsigned checksumErrors;
+	unsigned bursts;
+	BresserDecoder_t decoder;
+	BresserBurst_t burst;
+	BresserTable_t table;
+};
@@ -0,0 +1,65 @@
+/*
+ * BresserReplay.cpp
+ *
+ * Replays a pulse capture through the Bresser decoder on the host.
+ * Build: g++ -O2 -o BresserReplay BresserReplay.cpp BresserDecoder.c BresserBurst.c BresserSensorTable.c
+ * Usage: BresserReplay [-f | -g] [pulses.txt]	(reads stdin if omitted)
+ *
+ * Input: one pulse per line, "<level> <duration in us>", e.g. from the OOK demodulator.
+ * Output: one line per burst, "<id> <batteryLow> <test> <channel> <temperature 0.1 degC> <humidity> <copies>/<agreeing>",
+ *   with -f one line per frame without the quality field, or "CHKinv!",
+ *   with -g (gateway) a table of all sensors seen every 60 s of capture time.
+ */ 
+
+#include <cstdio>
+#include <cstdint>
+#include <cinttypes>
+#include <unistd.h>
+
+#include "BresserPipeline.h"
+
+
+int main(int argc, char* argv[])
+{
+	BresserPipeline::Output output = BresserPipeline::BURSTS;
+	int opt;
+	
+	while ((opt = getopt(argc, argv, "fg")) != -1)
+	{
+		switch (opt)
+		{
+			case 'f':
+				output = BresserPipeline::FRAMES;
+				break;
+			case 'g':
+				output = BresserPipeline::GATEWAY;
+				break;
+			default:
+				fprintf(stderr, "Usage: %s [-f | -g] [pulses.txt]\n", argv[0]);
+				return 1;
+		}
+	}
+	
+	FILE* input = (optind < argc) ? fopen(argv[optind], "r") : stdin;
+	if (!input)
+	{
+		perror(argv[optind]);
+		return 1;
+	}
+	
+	BresserPipeline pipeline(output);
+	unsigned level;
+	uint32_t duration;
+	
+	while (fscanf(input, "%u %" SCNu32, &level, &duration) == 2)
+	{
+		pipeline.pulse(level != 0, duration);
+	}
+	pipeline.finish();
+	
+	if (input != stdin)
+	{
+		fclose(input);
+	}
+	return 0;
+}
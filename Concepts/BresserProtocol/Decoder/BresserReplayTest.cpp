@@ -0,0 +1,194 @@
+/*
+ * BresserReplayTest.cpp
+ *
+ * Self-checking test of the pulse -> frame -> burst chain on synthetic captures of several senders.
+ * Build: g++ -O2 -o BresserReplayTest BresserReplayTest.cpp BresserDecoder.c BresserBurst.c
+ * Usage: BresserReplayTest [-p scenario]	(exit code 0 if all scenarios pass)
+ *   -p  print the pulses of a scenario instead of testing (input format of BresserReplay)
+ *
+ * Each sender has to be reported exactly once per burst with all 15 copies, also if the bursts of
+ * different sensors follow each other closer than BRESSER_BURST_GAP_MS or their frames alternate.
+ */ 
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+#include <unistd.h>
+
+#include "BresserDecoder.h"
+#include "BresserBurst.h"
+#include "SyntheticCapture.h"
+
+
+struct Scenario
+{
+	const char* name;
+	uint32_t burstSpacingUs;	/* Silence between the bursts of consecutive senders */
+	bool interleaved;			/* Frames of all senders alternate instead of one burst after the other */
+	uint8_t corruptEvery;		/* Flip one data bit in every n-th copy, 0 = none */
+};
+
+
+static const SyntheticSender senders[] =
+{
+	{ 232, 2, 720, 55 },
+	{ 17, 1, 320, 80 },
+	{ 17, 3, 1045, 23 },		/* Same id on another channel */
+};
+static const size_t senderCount = sizeof(senders) / sizeof(senders[0]);
+
+static const Scenario scenarios[] =
+{
+	{ "bursts 100 ms apart", 100000, false, 0 },
+	{ "bursts 100 ms apart, bit errors", 100000, false, 4 },
+	{ "bursts 1 s apart", 1000000, false, 0 },
+	{ "frames interleaved", 0, true, 0 },
+	{ "frames interleaved, bit errors", 0, true, 5 },
+};
+static const size_t scenarioCount = sizeof(scenarios) / sizeof(scenarios[0]);
+
+
+/* Any bit except the sender bits (id, channel), -1 for an intact copy */
+static int errorBit(const Scenario& scenario, unsigned copy)
+{
+	if (scenario.corruptEvery == 0 || (copy % scenario.corruptEvery) != 0)
+	{
+		return -1;
+	}
+	int bit;
+	do
+	{
+		bit = 8 + rand() % (BRESSER_DATA_BITS - 8);
+	}
+	while (bit == 10 || bit == 11);
+	return bit;
+}
+
+
+static SyntheticCapture generate(const Scenario& scenario)
+{
+	SyntheticCapture capture;
+	unsigned copy = 0;
+	
+	capture.silence(50000);
+	if (scenario.interleaved)
+	{
+		for (uint8_t i = 0; i < BRESSER_BURST_COPIES; ++i)
+		{
+			for (size_t s = 0; s < senderCount; ++s, ++copy)
+			{
+				capture.copy(senders[s].frame(), errorBit(scenario, copy));
+			}
+		}
+	}
+	else
+	{
+		for (size_t s = 0; s < senderCount; ++s)
+		{
+			for (uint8_t i = 0; i < BRESSER_BURST_COPIES; ++i, ++copy)
+			{
+				capture.copy(senders[s].frame(), errorBit(scenario, copy));
+			}
+			capture.silence(scenario.burstSpacingUs);
+		}
+	}
+	capture.silence(1000000);
+	return capture;
+}
+
+
+static bool isEqual(const BresserRecord_t& a, const BresserRecord_t& b)
+{
+	return a.id == b.id && a.batteryLow == b.batteryLow && a.test == b.test && a.channel == b.channel
+		&& a.temperature == b.temperature && a.humidity == b.humidity;
+}
+
+
+static bool run(const Scenario& scenario)
+{
+	BresserDecoder_t decoder;
+	BresserBurst_t burst;
+	BresserFrame_t frame;
+	BresserBurstResult_t result;
+	std::vector<BresserBurstResult_t> results;
+	uint32_t time = 0;
+	
+	bresserDecoderInit(&decoder, BRESSER_BIT_PERIOD_US);
+	bresserBurstInit(&burst, BRESSER_BURST_GAP_MS * 1000UL);
+	
+	SyntheticCapture capture = generate(scenario);
+	for (const SyntheticCapture::Pulse& pulse : capture.pulses())
+	{
+		time += pulse.durationUs;
+		if (bresserBurstPoll(&burst, time, &result))
+		{
+			results.push_back(result);
+		}
+		if (bresserDecoderPulse(&decoder, pulse.level, (pulse.durationUs > 0xFFFF) ? 0xFFFF : pulse.durationUs, &frame)
+			&& bresserBurstFrame(&burst, &frame, time, &result))
+		{
+			results.push_back(result);
+		}
+	}
+	while (bresserBurstFinish(&burst, &result))
+	{
+		results.push_back(result);
+	}
+	
+	bool passed = (results.size() == senderCount);
+	for (size_t s = 0; s < senderCount; ++s)
+	{
+		BresserRecord_t expected;
+		BresserFrame_t ideal = senders[s].frame();
+		bresserFrameDecode(&ideal, &expected);
+		
+		unsigned found = 0;
+		for (const BresserBurstResult_t& r : results)
+		{
+			if (isEqual(r.record, expected) && r.copies == BRESSER_BURST_COPIES)
+			{
+				++found;
+			}
+		}
+		passed &= (found == 1);
+	}
+	
+	printf("%-32s %s, %zu records:", scenario.name, passed ? "passed" : "FAILED", results.size());
+	for (const BresserBurstResult_t& r : results)
+	{
+		printf(" %u/%u %u/%u", r.record.id, r.record.channel, r.copies, r.agreeing);
+	}
+	printf("\n");
+	return passed;
+}
+
+
+int main(int argc, char* argv[])
+{
+	int opt;
+	
+	while ((opt = getopt(argc, argv, "p:")) != -1)
+	{
+		size_t index = atoi(optarg);
+		if (opt != 'p' || index >= scenarioCount)
+		{
+			fprintf(stderr, "Usage: %s [-p 0..%zu]\n", argv[0], scenarioCount - 1);
+			return 1;
+		}
+		SyntheticCapture capture = generate(scenarios[index]);
+		for (const SyntheticCapture::Pulse& pulse : capture.pulses())
+		{
+			printf("%u %u\n", pulse.level, pulse.durationUs);
+		}
+		return 0;
+	}
+	
+	bool passed = true;
+	for (const Scenario& scenario : scenarios)
+	{
+		passed &= run(scenario);
+	}
+	return passed ? 0 : 1;
+}
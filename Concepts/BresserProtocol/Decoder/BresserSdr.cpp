@@ -0,0 +1,116 @@
+/*
+ * BresserSdr.cpp
+ *
+ * Decodes Bresser sensors from a raw SDR capture, e.g.
+ *   rtl_sdr -f 433920000 -s 1000000 - | BresserSdr
+ * Build: g++ -O2 -o BresserSdr BresserSdr.cpp OokDemodulator.cpp BresserDecoder.c BresserBurst.c BresserSensorTable.c
+ * Usage: BresserSdr [-s samplerate] [-k scalar|sse2|avx2] [-p | -f | -g] [capture.cu8]	(reads stdin if omitted)
+ *   -p  print the pulses instead of decoding (input format of BresserReplay)
+ *   -f  print every frame instead of one voted record per burst (see BresserReplay)
+ *   -g  gateway mode, periodic table of all sensors seen (see BresserReplay)
+ */ 
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+#include "BresserPipeline.h"
+#include "OokDemodulator.h"
+
+
+class PulsePrinter : public PulseSink
+{
+public:
+	void pulse(uint8_t level, uint32_t durationUs)
+	{
+		printf("%u %u\n", level, durationUs);
+	}
+};
+
+
+class PipelineSink : public PulseSink
+{
+public:
+	explicit PipelineSink(BresserPipeline::Output output) : pipeline(output) {}
+	
+	void pulse(uint8_t level, uint32_t durationUs)
+	{
+		pipeline.pulse(level, durationUs);
+	}
+	
+	BresserPipeline pipeline;
+};
+
+
+int main(int argc, char* argv[])
+{
+	uint32_t sampleRate = 1000000;
+	OokDemodulator::Kernel kernel = OokDemodulator::AUTO;
+	bool printPulses = false;
+	BresserPipeline::Output output = BresserPipeline::BURSTS;
+	int opt;
+	
+	while ((opt = getopt(argc, argv, "s:k:pfg")) != -1)
+	{
+		switch (opt)
+		{
+			case 's':
+				sampleRate = strtoul(optarg, nullptr, 0);
+				break;
+			case 'k':
+				kernel = !strcmp(optarg, "avx2") ? OokDemodulator::AVX2 : !strcmp(optarg, "sse2") ? OokDemodulator::SSE2 : OokDemodulator::SCALAR;
+				break;
+			case 'p':
+				printPulses = true;
+				break;
+			case 'f':
+				output = BresserPipeline::FRAMES;
+				break;
+			case 'g':
+				output = BresserPipeline::GATEWAY;
+				break;
+			default:
+				fprintf(stderr, "Usage: %s [-s samplerate] [-k scalar|sse2|avx2] [-p | -f | -g] [capture.cu8]\n", argv[0]);
+				return 1;
+		}
+	}
+	
+	FILE* input = (optind < argc) ? fopen(argv[optind], "rb") : stdin;
+	if (!input || sampleRate == 0)
+	{
+		perror(argv[optind]);
+		return 1;
+	}
+	
+	OokDemodulator demodulator(sampleRate);
+	demodulator.setKernel(kernel);
+	
+	PulsePrinter printer;
+	PipelineSink decoder(output);
+	PulseSink& sink = printPulses ? (PulseSink&)printer : (PulseSink&)decoder;
+	
+	static uint8_t buffer[2 * 65536];
+	size_t pending = 0;
+	size_t count;
+	while ((count = fread(buffer + pending, 1, sizeof(buffer) - pending, input)) > 0)
+	{
+		count += pending;
+		demodulator.process(buffer, count / 2, sink);
+		// Keep a dangling I without Q for the next round
+		pending = count & 1;
+		buffer[0] = buffer[count - pending];
+	}
+	demodulator.flush(sink);
+	
+	if (!printPulses)
+	{
+		decoder.pipeline.finish();
+	}
+	
+	if (input != stdin)
+	{
+		fclose(input);
+	}
+	return 0;
+}
@@ -0,0 +1,121 @@
+#include "BresserSensorTable.h"
+#include <string.h>
+
+
+static uint16_t hash(uint8_t id, uint8_t channel)
+{
+	/* Fibonacci hashing of the 10 bit key: the top bits of the 16 bit product depend on all key bits */
+	uint16_t key = ((uint16_t)channel << 8) | id;
+	return (uint16_t)(key * 40503u) / (0x10000UL / BRESSER_TABLE_SIZE);
+}
+
+
+void bresserTableInit(BresserTable_t *table, uint32_t staleAge)
+{
+	memset(table, 0, sizeof(*table));
+	table->staleAge = staleAge;
+}
+
+
+BresserSensor_t *bresserTableFind(BresserTable_t *table, uint8_t id, uint8_t channel)
+{
+	uint16_t slot = hash(id, channel);
+	
+	for (uint16_t probe = 0; probe < BRESSER_TABLE_SIZE; ++probe)
+	{
+		BresserSensor_t *sensor = &table->sensors[slot];
+		if (!sensor->used)
+		{
+			return NULL;
+		}
+		if (sensor->id == id && sensor->channel == channel)
+		{
+			return sensor;
+		}
+		slot = (slot + 1) & (BRESSER_TABLE_SIZE - 1);
+	}
+	return NULL;
+}
+
+
+static BresserSensor_t *findOrInsert(BresserTable_t *table, uint8_t id, uint8_t channel, uint32_t time)
+{
+	uint16_t slot = hash(id, channel);
+	BresserSensor_t *oldest = NULL;
+	BresserSensor_t *sensor = NULL;
+	
+	for (uint16_t probe = 0; probe < BRESSER_TABLE_SIZE; ++probe)
+	{
+		sensor = &table->sensors[slot];
+		if (!sensor->used)
+		{
+			break;
+		}
+		if (sensor->id == id && sensor->channel == channel)
+		{
+			return sensor;
+		}
+		if (!oldest || (uint32_t)(time - sensor->lastSeen) > (uint32_t)(time - oldest->lastSeen))
+		{
+			oldest = sensor;
+		}
+		slot = (slot + 1) & (BRESSER_TABLE_SIZE - 1);
+	}
+	
+	/* Unknown sensor: prefer reusing a stale entry over growing the chain */
+	if (oldest && ((uint32_t)(time - oldest->lastSeen) > table->staleAge || sensor->used))
+	{
+		sensor = oldest;
+		++table->evictions;
+	}
+	else
+	{
+		++table->count;
+	}
+	
+	memset(sensor, 0, sizeof(*sensor));
+	sensor->id = id;
+	sensor->channel = channel;
+	sensor->used = true;
+	return sensor;
+}
+
+
+BresserSensor_t *bresserTableUpdate(BresserTable_t *table, const BresserBurstResult_t *result, uint32_t time)
+{
+	BresserSensor_t *sensor = findOrInsert(table, result->record.id, result->record.channel, time);
+	
+	if (sensor->frames > 0xFFFF - BRESSER_BURST_COPIES)
+	{
+		/* Keep the error rate, drop the history */
+		sensor->frames >>= 1;
+		sensor->badFrames >>= 1;
+	}
+	
+	sensor->last = result->record;
+	sensor->lastSeen = time;
+	if (sensor->bursts < 0xFFFF)
+	{
+		++sensor->bursts;
+	}
+	sensor->frames += result->copies;
+	sensor->badFrames += result->copies - result->agreeing;
+	
+	if (sensor->bursts == 1)
+	{
+		sensor->bitPeriod = sensor->bitPeriodMin = sensor->bitPeriodMax = result->bitPeriod;
+	}
+	else
+	{
+		sensor->bitPeriod += ((int16_t)(result->bitPeriod - sensor->bitPeriod)) / 4;
+		if (result->bitPeriod < sensor->bitPeriodMin)
+		{
+			sensor->bitPeriodMin = result->bitPeriod;
+		}
+		if (result->bitPeriod > sensor->bitPeriodMax)
+		{
+			sensor->bitPeriodMax = result->bitPeriod;
+		}
+	}
+	return sensor;
+}
@@ -0,0 +1,69 @@
+#ifndef _BRESSER_SENSOR_TABLE_H_
+#define _BRESSER_SENSOR_TABLE_H_
+
+/*
+ * Gateway bookkeeping: fixed capacity open addressing table (linear probing) keyed by (id, channel).
+ * Holds the last reading, last-seen time, frame and clock drift statistics per sensor, without dynamic allocation.
+ * Slots are never emptied, a stale entry is overwritten in place when a new sensor needs a slot,
+ * which keeps the probe chains intact.
+ */
+
+#include "BresserBurst.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef BRESSER_TABLE_SIZE
+#  ifdef __AVR__
+#    define BRESSER_TABLE_SIZE			16		/* ~27 bytes per entry */
+#  else
+#    define BRESSER_TABLE_SIZE			1024	/* Every possible key (256 ids x 4 channels) */
+#  endif
+#endif
+
+#if (BRESSER_TABLE_SIZE & (BRESSER_TABLE_SIZE - 1)) != 0 || BRESSER_TABLE_SIZE > 1024
+#  error "BRESSER_TABLE_SIZE must be a power of 2 <= 1024"
+#endif
+
+
+typedef struct
+{
+	uint8_t id;
+	uint8_t channel;
+	bool used;
+	BresserRecord_t last;
+	uint32_t lastSeen;			/* Caller time units */
+	uint16_t bursts;
+	uint16_t frames;			/* Copies received */
+	uint16_t badFrames;			/* Copies not agreeing with the voted result */
+	uint16_t bitPeriod;			/* Clock drift: average (1/4 weight per burst), min and max measured bit period [ticks] */
+	uint16_t bitPeriodMin;
+	uint16_t bitPeriodMax;
+} BresserSensor_t;
+
+
+typedef struct
+{
+	uint32_t staleAge;
+	uint16_t count;
+	uint16_t evictions;
+	BresserSensor_t sensors[BRESSER_TABLE_SIZE];
+} BresserTable_t;
+
+
+/*! staleAge: entries not seen for longer [caller time units] may be replaced by new sensors. */
+void bresserTableInit(BresserTable_t *table, uint32_t staleAge);
+
+/*! Account a burst. Returns the sensor's entry - a new sensor replaces a stale entry or, with the table full,
+ *  the least recently seen one in its probe chain. */
+BresserSensor_t *bresserTableUpdate(BresserTable_t *table, const BresserBurstResult_t *result, uint32_t time);
+
+/*! NULL if unknown. */
+BresserSensor_t *bresserTableFind(BresserTable_t *table, uint8_t id, uint8_t channel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BRESSER_SENSOR_TABLE_H_ */
@@ -0,0 +1,226 @@
+/*
+ * OokDemodulator.cpp
+ *
+ * Magnitude: SSE2/AVX2 kernels with scalar fallback, selected at runtime.
+ * Slicing: the noise floor and the pulse level are tracked with exponential averages,
+ * a pulse starts when the magnitude exceeds the noise floor by OOK_MIN_SNR and ends
+ * below the midpoint between noise floor and pulse level. Level changes are debounced
+ * by integrating over 1 / OOK_MIN_PULSE_RATE.
+ */ 
+
+#include "OokDemodulator.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#  define OOK_X86
+#  include <immintrin.h>
+#endif
+
+#define OOK_MIN_SNR						3		/* Squared magnitude ratio, ~5 dB */
+#define OOK_MIN_LEVEL					(64 << 8)	/* Absolute minimum pulse level (squared magnitude << 8) */
+#define OOK_AVERAGE_SHIFT				6		/* Exponential average weight 1/64 */
+#define OOK_SMOOTHING_SHIFT				2		/* Magnitude low-pass weight 1/4 */
+#define OOK_MIN_PULSE_RATE				100000	/* Shortest level change accepted: 10 us */
+#define OOK_MAGNITUDE_MAX				32767
+
+
+static void magnitudeScalar(const uint8_t* iq, uint16_t* mag, size_t n)
+{
+	for (size_t k = 0; k < n; ++k)
+	{
+		int32_t i = (int32_t)iq[2 * k] - 128;
+		int32_t q = (int32_t)iq[2 * k + 1] - 128;
+		int32_t m = i * i + q * q;
+		mag[k] = (m > OOK_MAGNITUDE_MAX) ? OOK_MAGNITUDE_MAX : m;
+	}
+}
+
+
+#ifdef OOK_X86
+__attribute__((target("sse2")))
+static void magnitudeSse2(const uint8_t* iq, uint16_t* mag, size_t n)
+{
+	const __m128i bias = _mm_set1_epi8((char)0x80);
+	size_t k = 0;
+	
+	for (; k + 8 <= n; k += 8)
+	{
+		// 8 I/Q pairs, x - 128 as signed 8 bit
+		__m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(iq + 2 * k)), bias);
+		// Sign extend to 16 bit
+		__m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+		__m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8);
+		// I * I + Q * Q per pair
+		__m128i a = _mm_madd_epi16(lo, lo);
+		__m128i b = _mm_madd_epi16(hi, hi);
+		_mm_storeu_si128((__m128i*)(mag + k), _mm_packs_epi32(a, b));
+	}
+	magnitudeScalar(iq + 2 * k, mag + k, n - k);
+}
+
+
+__attribute__((target("avx2")))
+static void magnitudeAvx2(const uint8_t* iq, uint16_t* mag, size_t n)
+{
+	const __m256i bias = _mm256_set1_epi8((char)0x80);
+	size_t k = 0;
+	
+	for (; k + 16 <= n; k += 16)
+	{
+		// Same as SSE2 per 128 bit lane; unpack and pack both work lane-wise, so the order is preserved
+		__m256i v = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(iq + 2 * k)), bias);
+		__m256i lo = _mm256_srai_epi16(_mm256_unpacklo_epi8(v, v), 8);
+		__m256i hi = _mm256_srai_epi16(_mm256_unpackhi_epi8(v, v), 8);
+		__m256i a = _mm256_madd_epi16(lo, lo);
+		__m256i b = _mm256_madd_epi16(hi, hi);
+		_mm256_storeu_si256((__m256i*)(mag + k), _mm256_packs_epi32(a, b));
+	}
+	magnitudeSse2(iq + 2 * k, mag + k, n - k);
+}
+#endif
+
+
+OokDemodulator::OokDemodulator(uint32_t sampleRate)
+	: sampleRate(sampleRate), minSamples(sampleRate / OOK_MIN_PULSE_RATE + 1),
+	  smoothed(0), noiseLevel(1 << 8), signalLevel(0), level(0), samplesInLevel(0), pendingSamples(0)
+{
+	setKernel(AUTO);
+}
+
+
+void OokDemodulator::setKernel(Kernel kernel)
+{
+#ifdef OOK_X86
+	if (kernel == AUTO)
+	{
+		kernel = __builtin_cpu_supports("avx2") ? AVX2 : SSE2;
+	}
+	if (kernel == AVX2 && !__builtin_cpu_supports("avx2"))
+	{
+		kernel = SSE2;
+	}
+#else
+	kernel = SCALAR;
+#endif
+	
+	kernelId = kernel;
+	switch (kernel)
+	{
+#ifdef OOK_X86
+		case AVX2:
+			this->kernel = magnitudeAvx2;
+			break;
+		case SSE2:
+			this->kernel = magnitudeSse2;
+			break;
+#endif
+		default:
+			kernelId = SCALAR;
+			this->kernel = magnitudeScalar;
+			break;
+	}
+}
+
+
+const char* OokDemodulator::kernelName() const
+{
+	switch (kernelId)
+	{
+		case AVX2: return "avx2";
+		case SSE2: return "sse2";
+		default: return "scalar";
+	}
+}
+
+
+void OokDemodulator::magnitude(const uint8_t* iq, uint16_t* mag, size_t n) const
+{
+	kernel(iq, mag, n);
+}
+
+
+void OokDemodulator::process(const uint8_t* iq, size_t n, PulseSink& sink)
+{
+	while (n > 0)
+	{
+		size_t count = (n < BLOCK_SIZE) ? n : BLOCK_SIZE;
+		kernel(iq, block, count);
+		slice(block, count, sink);
+		iq += 2 * count;
+		n -= count;
+	}
+}
+
+
+void OokDemodulator::slice(const uint16_t* mag, size_t n, PulseSink& sink)
+{
+	for (size_t k = 0; k < n; ++k)
+	{
+		// Low-pass against the Rician fluctuation of weak signals
+		smoothed += ((int32_t)(((uint32_t)mag[k] << 8) - smoothed)) >> OOK_SMOOTHING_SHIFT;
+		uint32_t m = smoothed;
+		bool toggle;
+		
+		++samplesInLevel;
+		if (level == 0)
+		{
+			toggle = (m > noiseLevel * OOK_MIN_SNR && m > OOK_MIN_LEVEL);
+			if (!toggle)
+			{
+				noiseLevel += ((int32_t)(m - noiseLevel)) >> OOK_AVERAGE_SHIFT;
+				if (noiseLevel == 0)
+				{
+					noiseLevel = 1;
+				}
+			}
+		}
+		else
+		{
+			toggle = (m < noiseLevel + (signalLevel - noiseLevel) / 2);
+			if (!toggle)
+			{
+				signalLevel += ((int32_t)(m - signalLevel)) >> OOK_AVERAGE_SHIFT;
+			}
+		}
+		
+		// Debounce: integrate samples voting for the other level, switch when minSamples are reached.
+		// The new level is back-dated by the time it took to get there.
+		if (!toggle)
+		{
+			if (pendingSamples > 0)
+			{
+				--pendingSamples;
+			}
+			continue;
+		}
+		if (pendingSamples == 0 && level == 0)
+		{
+			signalLevel = m;
+		}
+		if (++pendingSamples < minSamples)
+		{
+			continue;
+		}
+		samplesInLevel -= pendingSamples;
+		emit(sink);
+		samplesInLevel = pendingSamples;
+		pendingSamples = 0;
+		level ^= 1;
+	}
+}
+
+
+void OokDemodulator::emit(PulseSink& sink)
+{
+	if (samplesInLevel > 0)
+	{
+		sink.pulse(level, (uint32_t)((samplesInLevel * 1000000ULL + sampleRate / 2) / sampleRate));
+	}
+	samplesInLevel = 0;
+}
+
+
+void OokDemodulator::flush(PulseSink& sink)
+{
+	emit(sink);
+	level = 0;
+}
@@ -0,0 +1,62 @@
+/*
+ * OokDemodulator.h
+ *
+ * On-off keying demodulator for raw SDR captures (.cu8 = interleaved unsigned 8 bit I/Q, e.g. rtl_sdr).
+ * Produces the same (level, duration) pulse stream as the timer capture receiver.
+ */ 
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+class PulseSink
+{
+public:
+	virtual ~PulseSink() {}
+	virtual void pulse(uint8_t level, uint32_t durationUs) = 0;
+};
+
+
+class OokDemodulator
+{
+public:
+	explicit OokDemodulator(uint32_t sampleRate);
+	
+	// Magnitude kernel selection, AUTO picks the best one the CPU supports
+	enum Kernel { AUTO, SCALAR, SSE2, AVX2 };
+	void setKernel(Kernel kernel);
+	const char* kernelName() const;
+	
+	// Squared magnitude of n I/Q pairs (saturated at 32767), exposed for benchmarking
+	void magnitude(const uint8_t* iq, uint16_t* mag, size_t n) const;
+	
+	// Feed n I/Q pairs, pulses are reported to sink
+	void process(const uint8_t* iq, size_t n, PulseSink& sink);
+	
+	// Report the pending pulse (end of input)
+	void flush(PulseSink& sink);
+	
+private:
+	typedef void (*MagnitudeKernel)(const uint8_t* iq, uint16_t* mag, size_t n);
+	
+	void slice(const uint16_t* mag, size_t n, PulseSink& sink);
+	void emit(PulseSink& sink);
+	
+	MagnitudeKernel kernel;
+	Kernel kernelId;
+	uint32_t sampleRate;
+	uint32_t minSamples;
+	
+	// Adaptive threshold state, in squared magnitude units << 8
+	uint32_t smoothed;
+	uint32_t noiseLevel;
+	uint32_t signalLevel;
+	uint8_t level;
+	uint64_t samplesInLevel;
+	uint32_t pendingSamples;
+	
+	static const size_t BLOCK_SIZE = 4096;
+	uint16_t block[BLOCK_SIZE];
+};
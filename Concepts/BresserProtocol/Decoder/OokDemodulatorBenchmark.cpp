@@ -0,0 +1,129 @@
+/*
+ * OokDemodulatorBenchmark.cpp
+ *
+ * Host throughput of the OOK demodulator per magnitude kernel, in samples per second (google-benchmark).
+ * Build: g++ -O2 -o OokDemodulatorBenchmark OokDemodulatorBenchmark.cpp OokDemodulator.cpp BresserDecoder.c BresserBurst.c BresserSensorTable.c -lbenchmark -lpthread
+ * Usage: OokDemodulatorBenchmark [--benchmark_filter=...]
+ *
+ * Input is a synthetic 1 Msps capture of 4 bursts (carrier amplitude 40 LSB, noise 4 LSB), about 3.5 s on air.
+ * The "realtime" counter is the multiple of real time at 1 Msps, the requirement is >= 10.
+ */ 
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "BresserPipeline.h"
+#include "OokDemodulator.h"
+#include "SyntheticCapture.h"
+
+#define SAMPLE_RATE				1000000
+
+
+static const std::vector<uint8_t>& capture()
+{
+	static std::vector<uint8_t> iq;
+	
+	if (iq.empty())
+	{
+		SyntheticCapture capture;
+		capture.silence(100000);
+		for (uint8_t i = 0; i < 4; ++i)
+		{
+			capture.burst(SyntheticSender{ (uint8_t)(100 + i), (uint8_t)(1 + i % 3), 720, 55 }.frame());
+			capture.silence(300000);
+		}
+		iq = capture.iq(SAMPLE_RATE);
+	}
+	return iq;
+}
+
+
+class CountingSink : public PulseSink
+{
+public:
+	CountingSink() : pulses(0) {}
+	
+	void pulse(uint8_t, uint32_t)
+	{
+		++pulses;
+	}
+	
+	int64_t pulses;
+};
+
+
+class DecodingSink : public PulseSink
+{
+public:
+	void pulse(uint8_t level, uint32_t durationUs)
+	{
+		pipeline.pulse(level, durationUs);
+	}
+	
+	BresserPipeline pipeline;
+};
+
+
+static void setRealTime(benchmark::State& state, size_t samples)
+{
+	state.SetItemsProcessed(state.iterations() * samples);
+	state.counters["realtime"] = benchmark::Counter((double)state.iterations() * samples / SAMPLE_RATE, benchmark::Counter::kIsRate);
+}
+
+
+static void BM_Magnitude(benchmark::State& state)
+{
+	const std::vector<uint8_t>& iq = capture();
+	std::vector<uint16_t> magnitude(iq.size() / 2);
+	OokDemodulator demodulator(SAMPLE_RATE);
+	
+	demodulator.setKernel((OokDemodulator::Kernel)state.range(0));
+	state.SetLabel(demodulator.kernelName());
+	for (auto _ : state)
+	{
+		demodulator.magnitude(iq.data(), magnitude.data(), magnitude.size());
+		benchmark::DoNotOptimize(magnitude.data());
+	}
+	setRealTime(state, magnitude.size());
+}
+BENCHMARK(BM_Magnitude)->Arg(OokDemodulator::SCALAR)->Arg(OokDemodulator::SSE2)->Arg(OokDemodulator::AVX2);
+
+
+// Magnitude, adaptive threshold and pulse slicing
+static void BM_Demodulate(benchmark::State& state)
+{
+	const std::vector<uint8_t>& iq = capture();
+	OokDemodulator demodulator(SAMPLE_RATE);
+	CountingSink sink;
+	
+	demodulator.setKernel((OokDemodulator::Kernel)state.range(0));
+	state.SetLabel(demodulator.kernelName());
+	for (auto _ : state)
+	{
+		demodulator.process(iq.data(), iq.size() / 2, sink);
+	}
+	setRealTime(state, iq.size() / 2);
+	state.counters["pulses"] = benchmark::Counter(sink.pulses, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_Demodulate)->Arg(OokDemodulator::SCALAR)->Arg(OokDemodulator::SSE2)->Arg(OokDemodulator::AVX2);
+
+
+// Complete BresserSdr chain up to the voted records (printed to stdout, redirect it)
+static void BM_DemodulateAndDecode(benchmark::State& state)
+{
+	const std::vector<uint8_t>& iq = capture();
+	OokDemodulator demodulator(SAMPLE_RATE);
+	DecodingSink sink;
+	
+	for (auto _ : state)
+	{
+		demodulator.process(iq.data(), iq.size() / 2, sink);
+	}
+	setRealTime(state, iq.size() / 2);
+}
+BENCHMARK(BM_DemodulateAndDecode);
+
+
+BENCHMARK_MAIN();
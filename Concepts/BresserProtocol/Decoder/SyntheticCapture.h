@@ -0,0 +1,165 @@
+/*
+ * SyntheticCapture.h
+ *
+ * Host side generator of Bresser pulse streams and raw SDR captures, shared by the tests and benchmarks.
+ */ 
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "BresserDecoder.h"
+#include "BresserBurst.h"
+
+
+struct SyntheticSender
+{
+	uint8_t id;
+	uint8_t channel;
+	int16_t fahrenheit;			// 0.1 degF
+	uint8_t humidity;
+	
+	BresserFrame_t frame() const
+	{
+		BresserFrame_t frame;
+		uint16_t raw = fahrenheit + 900;
+		
+		memset(&frame, 0, sizeof(frame));
+		frame.data[0] = id;
+		frame.data[1] = ((channel & 0x3) << 4) | ((raw >> 8) & 0xF);
+		frame.data[2] = raw & 0xFF;
+		frame.data[3] = humidity;
+		frame.data[4] = frame.data[0] + frame.data[1] + frame.data[2] + frame.data[3];
+		return frame;
+	}
+};
+
+
+class SyntheticCapture
+{
+public:
+	struct Pulse
+	{
+		uint8_t level;
+		uint32_t durationUs;
+	};
+	
+	static const uint32_t FRAME_GAP_US = 1000;		// Silence after each copy (transmitter loop)
+	
+	// jitterUs: uniform timing error of each pulse, seed: for reproducible jitter and bit errors
+	explicit SyntheticCapture(uint32_t jitterUs = 20, unsigned seed = 1)
+		: jitterUs(jitterUs)
+	{
+		srand(seed);
+	}
+	
+	void silence(uint32_t durationUs)
+	{
+		append(0, durationUs);
+	}
+	
+	// One copy on air, errorBit >= 0 flips that data bit
+	void copy(BresserFrame_t frame, int errorBit = -1)
+	{
+		const uint32_t t = BRESSER_BIT_PERIOD_US / 3;
+		
+		if (errorBit >= 0)
+		{
+			frame.data[errorBit >> 3] ^= 0x80 >> (errorBit & 7);
+		}
+		for (uint8_t i = 0; i < BRESSER_PREAMBLE_BITS; ++i)
+		{
+			append((i & 1) == 0, jitter(3 * t));
+		}
+		for (uint8_t i = 0; i < BRESSER_DATA_BITS; ++i)
+		{
+			bool one = (frame.data[i >> 3] & (0x80 >> (i & 7))) != 0;
+			append(1, jitter((one ? 2 : 1) * t));
+			append(0, jitter((one ? 1 : 2) * t));
+		}
+		silence(FRAME_GAP_US);
+	}
+	
+	// All copies of a burst
+	void burst(const BresserFrame_t& frame)
+	{
+		for (uint8_t i = 0; i < BRESSER_BURST_COPIES; ++i)
+		{
+			copy(frame);
+		}
+	}
+	
+	const std::vector<Pulse>& pulses() const
+	{
+		return pulseList;
+	}
+	
+	uint64_t durationUs() const
+	{
+		uint64_t duration = 0;
+		for (const Pulse& pulse : pulseList)
+		{
+			duration += pulse.durationUs;
+		}
+		return duration;
+	}
+	
+	// .cu8 samples (interleaved unsigned 8 bit I/Q) of an OOK carrier, amplitude and Gaussian noise in LSB
+	std::vector<uint8_t> iq(uint32_t sampleRate, double amplitude = 40.0, double noise = 4.0) const
+	{
+		std::vector<uint8_t> samples;
+		double phase = 0.0;
+		
+		samples.reserve(2 * durationUs() * sampleRate / 1000000);
+		for (const Pulse& pulse : pulseList)
+		{
+			uint64_t count = (uint64_t)pulse.durationUs * sampleRate / 1000000;
+			for (uint64_t i = 0; i < count; ++i)
+			{
+				double a = pulse.level ? amplitude : 0.0;
+				phase += 0.3;
+				samples.push_back(clamp(127.5 + a * cos(phase) + gauss(noise)));
+				samples.push_back(clamp(127.5 + a * sin(phase) + gauss(noise)));
+			}
+		}
+		return samples;
+	}
+	
+private:
+	void append(uint8_t level, uint32_t durationUs)
+	{
+		if (!pulseList.empty() && pulseList.back().level == level)
+		{
+			pulseList.back().durationUs += durationUs;
+		}
+		else
+		{
+			pulseList.push_back({ level, durationUs });
+		}
+	}
+	
+	uint32_t jitter(uint32_t durationUs) const
+	{
+		return jitterUs ? durationUs + (rand() % (2 * jitterUs + 1)) - jitterUs : durationUs;
+	}
+	
+	static double gauss(double sigma)
+	{
+		// Box-Muller
+		double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+		double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+		return sigma * sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+	}
+	
+	static uint8_t clamp(double value)
+	{
+		return (value < 0.0) ? 0 : (value > 255.0) ? 255 : (uint8_t)value;
+	}
+	
+	uint32_t jitterUs;
+	std::vector<Pulse> pulseList;
+};
@@ -0,0 +1,84 @@
+#ifndef _CAPTURE_FIFO_H_
+#define _CAPTURE_FIFO_H_
+
+/*
+ * Single producer (edge ISR) / single consumer (main loop) ring of raw edge timestamps.
+ * Each index is written by one side only, so no locking is needed on either side.
+ * Shared by the receiver variants, decoding is done in the main loop.
+ */
+
+#include <stdbool.h>
+#include <util/atomic.h>
+
+#define CAPTURE_FIFO_SIZE		64		/* Must be a power of 2, a packet has 90 edges within 37 ms */
+#define CAPTURE_LOST_EDGES		0x80	/* Marks the first capture after a FIFO overflow */
+
+
+typedef struct
+{
+	uint16_t time;
+	uint8_t level;		/* Level after the edge, | CAPTURE_LOST_EDGES */
+} Capture_t;
+
+
+static volatile Capture_t captureFifo[CAPTURE_FIFO_SIZE];
+static volatile uint8_t captureHead;
+static volatile uint8_t captureTail;
+static volatile uint8_t captureLost;
+static volatile uint16_t captureOverflows;
+
+
+/* ISR side */
+static inline void capturePush(uint16_t time, uint8_t level)
+{
+	uint8_t head = captureHead;
+	uint8_t next = (head + 1) & (CAPTURE_FIFO_SIZE - 1);
+	
+	if (next == captureTail)
+	{
+		++captureOverflows;
+		captureLost = CAPTURE_LOST_EDGES;
+	}
+	else
+	{
+		captureFifo[head].time = time;
+		captureFifo[head].level = level | captureLost;
+		captureLost = 0;
+		captureHead = next;
+	}
+}
+
+
+/* Main loop side */
+static inline bool captureEmpty(void)
+{
+	return captureTail == captureHead;
+}
+
+
+static inline bool capturePop(uint16_t *time, uint8_t *level)
+{
+	uint8_t tail = captureTail;
+	
+	if (tail == captureHead)
+	{
+		return false;
+	}
+	*time = captureFifo[tail].time;
+	*level = captureFifo[tail].level;
+	captureTail = (tail + 1) & (CAPTURE_FIFO_SIZE - 1);
+	return true;
+}
+
+
+static uint16_t captureGetOverflows(void)
+{
+	uint16_t overflows;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		overflows = captureOverflows;
+	}
+	return overflows;
+}
+
+#endif /* _CAPTURE_FIFO_H_ */
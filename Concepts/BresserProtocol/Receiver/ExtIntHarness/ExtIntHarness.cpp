@@ -0,0 +1,284 @@
+/*
+ * ExtIntHarness.cpp
+ *
+ * Host-side pulse injection harness for the external interrupt receiver (main_extint.c).
+ * The receiver runs unmodified against simulated registers (see avr/io.h in this directory).
+ * Whenever it goes to sleep, the harness advances the simulated time to the next event and
+ * calls the ISR that would wake it up: INT0 with the pin level and Timer1 (1 us ticks) read
+ * after a few us of interrupt latency, or the Timer1 overflow. Edges during a busy main loop
+ * are queued in the capture FIFO.
+ * Build: g++ -std=gnu++17 -O2 -I. -o ExtIntHarness ExtIntHarness.cpp ../../Decoder/BresserDecoder.c ../../Decoder/BresserBurst.c
+ * Usage: ExtIntHarness	(exit code 0 if all scenarios pass)
+ *
+ * Each sender has to be reported on the UART exactly once per burst with all 15 copies.
+ * The wake-ups per scenario are counted as well. Only the number of wake-ups is simulated,
+ * not the time spent awake, so the current draw stated in main_extint.c remains an estimate.
+ */ 
+
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../../Decoder/SyntheticCapture.h"
+
+/* Not in glibc, used by SerialDebug.h */
+static char* itoa(int value, char* buffer, int radix)
+{
+	snprintf(buffer, 7, (radix == 16) ? "%x" : "%d", value);
+	return buffer;
+}
+
+#define _USE_EXTERNAL_INTERRUPT_
+#define main receiverMain
+#include "../main_extint.c"
+#undef main
+
+
+#define LATENCY_MIN_US					2		/* INT0 interrupt latency incl. ISR prologue at 8 MHz */
+#define LATENCY_MAX_US					8		/* ... delayed by another ISR */
+
+volatile uint8_t SREG;
+volatile uint8_t PINB, PORTB, DDRB;
+volatile uint8_t PORTC, DDRC;
+volatile uint8_t PIND;
+volatile uint8_t TCCR0B, TCNT0, TIFR0, TIMSK0;
+volatile uint8_t TCCR1B, TIMSK1;
+volatile uint16_t TCNT1;
+volatile uint8_t EICRA, EIFR, EIMSK;
+volatile uint8_t ACSR, PRR0, PRR1;
+SimUartStatus UCSR0A;
+volatile uint8_t UCSR0B, UCSR0C, UBRR0H, UBRR0L;
+SimUartData UDR0;
+volatile uint8_t simInterruptsEnabled;
+
+struct Edge
+{
+	uint64_t timeUs;
+	uint8_t level;
+};
+
+static struct
+{
+	std::vector<Edge> edges;
+	size_t nextEdge;
+	uint64_t nowUs;
+	uint64_t endUs;
+	uint32_t mainLoopUs;
+	std::string uart;
+	unsigned edgeWakeups;
+	unsigned overflowWakeups;
+	bool sleptWithInterruptsDisabled;
+	jmp_buf done;
+} sim;
+
+
+void SimUartData::operator=(uint8_t c)
+{
+	if (c != 0)
+	{
+		sim.uart.push_back((char)c);
+	}
+}
+
+
+void simSleep(void)
+{
+	if (!simInterruptsEnabled)
+	{
+		/* Nothing could wake up the CPU */
+		sim.sleptWithInterruptsDisabled = true;
+		longjmp(sim.done, 1);
+	}
+	
+	uint64_t overflowUs = (sim.nowUs | 0xFFFF) + 1;
+	if (sim.nextEdge < sim.edges.size() && sim.edges[sim.nextEdge].timeUs < overflowUs)
+	{
+		const Edge& edge = sim.edges[sim.nextEdge++];
+		sim.nowUs = edge.timeUs;
+		PIND = edge.level ? RX_PIN : 0;
+		TCNT1 = (uint16_t)(sim.nowUs + LATENCY_MIN_US + rand() % (LATENCY_MAX_US - LATENCY_MIN_US + 1));
+		sim.edgeWakeups++;
+		INT0_vect();
+	}
+	else if (overflowUs < sim.endUs)
+	{
+		sim.nowUs = overflowUs;
+		TCNT1 = 0;
+		sim.overflowWakeups++;
+		TIMER1_OVF_vect();
+	}
+	else
+	{
+		longjmp(sim.done, 1);
+	}
+	
+	/* Edges while the main loop is busy after the wake-up, queued in the FIFO */
+	while (sim.nextEdge < sim.edges.size() && sim.edges[sim.nextEdge].timeUs < sim.nowUs + sim.mainLoopUs)
+	{
+		const Edge& edge = sim.edges[sim.nextEdge++];
+		PIND = edge.level ? RX_PIN : 0;
+		TCNT1 = (uint16_t)(edge.timeUs + LATENCY_MIN_US + rand() % (LATENCY_MAX_US - LATENCY_MIN_US + 1));
+		INT0_vect();
+	}
+}
+
+
+struct Scenario
+{
+	const char* name;
+	uint32_t burstSpacingUs;	/* Silence between the bursts of consecutive senders */
+	bool interleaved;			/* Frames of all senders alternate instead of one burst after the other */
+	uint32_t mainLoopUs;		/* Time the main loop is busy after each wake-up */
+};
+
+
+static const SyntheticSender senders[] =
+{
+	{ 232, 2, 720, 55 },
+	{ 17, 1, 320, 80 },
+	{ 17, 3, 1045, 23 },
+};
+static const size_t senderCount = sizeof(senders) / sizeof(senders[0]);
+
+static const Scenario scenarios[] =
+{
+	{ "bursts 100 ms apart", 100000, false, 0 },
+	{ "bursts 1 s apart", 1000000, false, 0 },
+	{ "frames interleaved", 0, true, 0 },
+	{ "main loop busy 5 ms", 100000, false, 5000 },
+};
+
+
+static SyntheticCapture generate(const Scenario& scenario)
+{
+	SyntheticCapture capture;
+	
+	capture.silence(50000);
+	if (scenario.interleaved)
+	{
+		for (uint8_t i = 0; i < BRESSER_BURST_COPIES; ++i)
+		{
+			for (size_t s = 0; s < senderCount; ++s)
+			{
+				capture.copy(senders[s].frame());
+			}
+		}
+	}
+	else
+	{
+		for (size_t s = 0; s < senderCount; ++s)
+		{
+			capture.burst(senders[s].frame());
+			capture.silence(scenario.burstSpacingUs);
+		}
+	}
+	capture.silence(1000000);
+	return capture;
+}
+
+
+static void reset(const Scenario& scenario, const SyntheticCapture& capture)
+{
+	sim.edges.clear();
+	sim.nextEdge = 0;
+	sim.nowUs = 0;
+	sim.endUs = capture.durationUs();
+	sim.mainLoopUs = scenario.mainLoopUs;
+	sim.uart.clear();
+	sim.edgeWakeups = 0;
+	sim.overflowWakeups = 0;
+	sim.sleptWithInterruptsDisabled = false;
+	
+	/* The line idles low, every pulse after the first one starts with an edge */
+	uint64_t time = 0;
+	for (const SyntheticCapture::Pulse& pulse : capture.pulses())
+	{
+		if (time > 0)
+		{
+			sim.edges.push_back({ time, pulse.level });
+		}
+		time += pulse.durationUs;
+	}
+	
+	PINB = SW0_PIN;		/* Button released */
+	PIND = 0;
+	TCNT1 = 0;
+	TCCR0B = 0;
+	simInterruptsEnabled = 0;
+	srand(1);
+}
+
+
+static bool run(const Scenario& scenario)
+{
+	SyntheticCapture capture = generate(scenario);
+	reset(scenario, capture);
+	
+	if (setjmp(sim.done) == 0)
+	{
+		receiverMain();
+	}
+	
+	/* printBurst(): id batteryLow test channel temperature humidity copies/agreeing */
+	std::vector<BresserBurstResult_t> results;
+	const char* line = sim.uart.c_str();
+	int id, batteryLow, test, channel, temperature, humidity, copies, agreeing, length;
+	while (sscanf(line, "%d %d %d %d %d %d %d/%d\n%n", &id, &batteryLow, &test, &channel, &temperature, &humidity,
+		&copies, &agreeing, &length) == 8)
+	{
+		BresserBurstResult_t result;
+		result.record.id = id;
+		result.record.batteryLow = batteryLow;
+		result.record.test = test;
+		result.record.channel = channel;
+		result.record.temperature = temperature;
+		result.record.humidity = humidity;
+		result.copies = copies;
+		result.agreeing = agreeing;
+		results.push_back(result);
+		line += length;
+	}
+	
+	bool passed = (*line == '\0') && !sim.sleptWithInterruptsDisabled && (sim.nextEdge == sim.edges.size())
+		&& (results.size() == senderCount);
+	for (size_t s = 0; s < senderCount; ++s)
+	{
+		BresserRecord_t expected;
+		BresserFrame_t ideal = senders[s].frame();
+		bresserFrameDecode(&ideal, &expected);
+		
+		unsigned found = 0;
+		for (const BresserBurstResult_t& r : results)
+		{
+			found += (r.record.id == expected.id) && (r.record.batteryLow == expected.batteryLow)
+				&& (r.record.test == expected.test) && (r.record.channel == expected.channel)
+				&& (r.record.temperature == expected.temperature) && (r.record.humidity == expected.humidity)
+				&& (r.copies == BRESSER_BURST_COPIES);
+		}
+		passed &= (found == 1);
+	}
+	
+	printf("%-24s %s, %zu records, %u edge + %u timer wake-ups in %.2f s, %u FIFO overflows\n", scenario.name,
+		passed ? "passed" : "FAILED", results.size(), sim.edgeWakeups, sim.overflowWakeups, sim.nowUs / 1e6,
+		captureGetOverflows());
+	if (*line != '\0')
+	{
+		printf("  unexpected output: %s\n", line);
+	}
+	return passed;
+}
+
+
+int main()
+{
+	bool passed = true;
+	for (const Scenario& scenario : scenarios)
+	{
+		passed &= run(scenario);
+	}
+	return passed ? 0 : 1;
+}
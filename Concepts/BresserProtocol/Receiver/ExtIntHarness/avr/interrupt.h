@@ -0,0 +1,16 @@
+/*
+ * avr/interrupt.h
+ *
+ * Host simulation of the global interrupt flag (ExtIntHarness).
+ * Interrupts are injected by the harness while the receiver sleeps.
+ */ 
+
+#pragma once
+
+#include <stdint.h>
+
+extern volatile uint8_t simInterruptsEnabled;
+
+#define sei()							(simInterruptsEnabled = 1)
+#define cli()							(simInterruptsEnabled = 0)
+#define ISR(_vector_)					void _vector_(void)
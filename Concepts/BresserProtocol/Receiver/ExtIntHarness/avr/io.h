@@ -0,0 +1,74 @@
+/*
+ * avr/io.h
+ *
+ * Host simulation of the ATmega328PB registers used by main_extint.c (ExtIntHarness).
+ * Plain variables, except for the UART: the data register forwards the sent bytes to the harness
+ * and the transmitter is always ready.
+ */ 
+
+#pragma once
+
+#include <stdint.h>
+
+struct SimUartData
+{
+	void operator=(uint8_t c);
+};
+
+struct SimUartStatus
+{
+	uint8_t value;
+	
+	void operator=(uint8_t v) { value = v; }
+	operator uint8_t() const { return value | (1 << 5 /* UDRE0 */); }
+};
+
+extern volatile uint8_t SREG;
+extern volatile uint8_t PINB, PORTB, DDRB;
+extern volatile uint8_t PORTC, DDRC;
+extern volatile uint8_t PIND;
+extern volatile uint8_t TCCR0B, TCNT0, TIFR0, TIMSK0;
+extern volatile uint8_t TCCR1B, TIMSK1;
+extern volatile uint16_t TCNT1;
+extern volatile uint8_t EICRA, EIFR, EIMSK;
+extern volatile uint8_t ACSR, PRR0, PRR1;
+extern SimUartStatus UCSR0A;
+extern volatile uint8_t UCSR0B, UCSR0C, UBRR0H, UBRR0L;
+extern SimUartData UDR0;
+
+#define PB5				5
+#define PB7				7
+#define PC0				0
+#define PC5				5
+#define PD2				2
+
+#define CS00			0
+#define TOV0			0
+#define TOIE0			0
+#define CS10			0
+#define TOIE1			0
+#define ISC00			0
+#define INTF0			0
+#define INT0			0
+#define ACD				7
+
+#define PRADC			0
+#define PRUSART0		1
+#define PRSPI0			2
+#define PRTIM1			3
+#define PRUSART1		4
+#define PRTIM0			5
+#define PRTIM2			6
+#define PRTWI0			7
+#define PRTIM3			0
+#define PRSPI1			2
+#define PRTIM4			3
+#define PRPTC			4
+#define PRTWI1			5
+
+#define U2X0			1
+#define UDRE0			5
+#define UCSZ00			1
+#define TXEN0			3
+#define RXEN0			4
+#define RXCIE0			7
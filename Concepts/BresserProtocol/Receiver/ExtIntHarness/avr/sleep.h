@@ -0,0 +1,17 @@
+/*
+ * avr/sleep.h
+ *
+ * Host simulation of the sleep modes (ExtIntHarness). Sleeping hands over to the harness,
+ * which advances the simulated time to the next edge or timer overflow.
+ */ 
+
+#pragma once
+
+#define SLEEP_MODE_IDLE					0
+
+void simSleep(void);
+
+#define set_sleep_mode(_mode_)			((void)(_mode_))
+#define sleep_enable()
+#define sleep_disable()
+#define sleep_cpu()						simSleep()
@@ -0,0 +1,24 @@
+/*
+ * util/atomic.h
+ *
+ * Host simulation of ATOMIC_BLOCK (ExtIntHarness), same construction as the avr-libc original.
+ */ 
+
+#pragma once
+
+#include <avr/interrupt.h>
+
+static inline uint8_t simAtomicEnter(void)
+{
+	uint8_t enabled = simInterruptsEnabled;
+	simInterruptsEnabled = 0;
+	return enabled;
+}
+
+static inline void simAtomicRestore(const uint8_t* enabled)
+{
+	simInterruptsEnabled = *enabled;
+}
+
+#define ATOMIC_RESTORESTATE				uint8_t simAtomicState __attribute__((__cleanup__(simAtomicRestore))) = simAtomicEnter()
+#define ATOMIC_BLOCK(_type_)			for (_type_, simAtomicToDo = 1; simAtomicToDo; simAtomicToDo = 0)
@@ -0,0 +1,11 @@
+/*
+ * util/setbaud.h
+ *
+ * Host simulation of the avr-libc baud rate calculation (ExtIntHarness).
+ */ 
+
+#pragma once
+
+#define USE_2X							1
+#define UBRRH_VALUE						0
+#define UBRRL_VALUE						((F_CPU) / (8UL * (BAUD)) - 1)
@@ -1,19 +1,40 @@
 #ifdef _USE_EXTERNAL_INTERRUPT_
 
-/* !!! Sketch-up === not working !!! */
-
 /*
  * CPU = ATmega328PB
  * CLK = 8 MHz
+ *
+ * Receiver data output on INT0 (PD2) instead of ICP1 (PB0).
+ *
+ * Same FIFO and decoder as main_timer_capture.c, the difference is how the edges are timestamped:
+ * INT0 fires on any logical change and reads the free-running Timer1, the pin is sampled in the ISR for the level.
+ * Jitter is the interrupt latency (a few us, the TX ISR may delay it further) instead of 0 with the input capture unit,
+ * which is well within the decoder tolerance of 1/4 bit (~190 us).
+ *
+ * Current draw - UNVERIFIED ESTIMATE, nothing has been measured on hardware:
+ * the CPU sleeps in IDLE whenever the FIFO is empty and is woken by the edges (90 per packet),
+ * the Timer0 TX interrupt and the Timer1 overflow (every 66 ms, used to poll SW0 and complete bursts).
+ * ExtIntHarness/ replays synthetic captures through this file on the host and confirms the decoding and the
+ * wake-up counts (one per edge plus 15 per second), but not the time spent awake or the current.
+ * Timer1 keeps running in IDLE, but the CPU core and flash clocks are stopped - according to the ATmega328PB datasheet
+ * the typical IDLE current is about 1/4 of the active current at the same clock and supply.
+ * main_timer_capture.c spins in the main loop all the time and draws the full active current.
+ * Lower clocks do not pay off here, the UART needs 8 MHz for 250 kBaud.
+ * Note that the receiver module itself (several mA while listening) usually dominates the budget.
  */ 
 
 #define F_CPU					8000000UL
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/sleep.h>
 #include <util/delay.h>
+#include <util/atomic.h>
 #include <stdlib.h>
 #include "SerialDebug.h"
+#include "CaptureFifo.h"
+#include "../Decoder/BresserDecoder.h"
+#include "../Decoder/BresserBurst.h"
 
 #define SW0_PIN					(1 << PB7)
 #define SW0_PRESSED				((PINB & SW0_PIN) == 0)
@@ -57,115 +78,38 @@
 	TX_PIN_LOW(); \
 }
 
-#define PRELOAD_800US			0xFFE7
-#define PREAMBLE_TICKS			20
-#define BIT1_TICKS				14
-#define BIT0_TICKS				7
+#define RX_PIN					(1 << PD2)	/* INT0 */
+#define RX_LEVEL()				((PIND & RX_PIN) != 0)
+#define ANY_EDGE_INT			0x1
 
-#define FALLING_EDGE_INT		0x2
-#define RISING_EDGE_INT			0x3
+#define CAPTURE_TICK_US			1		/* Timer1 @ Clk/8 */
+#define TIMER1_OVERFLOW_MS		66		/* 65536 ticks, coarse clock for burst completion */
+#define BURST_GAP_OVERFLOWS		((BRESSER_BURST_GAP_MS + TIMER1_OVERFLOW_MS - 1) / TIMER1_OVERFLOW_MS)
 
 
 volatile uint8_t txBuffer[PACKET_LENGTH_BYTES];
 volatile uint8_t currentByte;
 volatile uint8_t currentBit;
 
-volatile uint8_t rxBuffer[PACKET_LENGTH_BYTES];
-volatile uint8_t rxData[PACKET_LENGTH_BYTES];
-volatile uint8_t currentRxByte;
-volatile uint8_t currentRxBit;
-volatile uint8_t rxComplete;
-volatile uint8_t preambleCount;
-volatile uint8_t currentRxByteValue;
+volatile uint32_t timerOverflows;
 
 
 ISR(TIMER1_OVF_vect)
 {
-	/* timeout occurred */
-	TCNT1 = PRELOAD_800US;	
-	EICRA = (RISING_EDGE_INT << ISC00);
-	EIMSK |= (1 << INT0);
-	preambleCount = 0;
-	currentRxBit = 0;
-	currentRxByte = 0;
-	rxComplete = 0;	
-	currentRxByteValue = 0;
-}
-
-
-void enqueueSample(const uint8_t bitValue)
-{
-	if (bitValue == 1)
-	{		
-		currentRxByteValue |= 1;
-	}
-	else if (bitValue == 0)
-	{		
-		currentRxByteValue &= ~1;
-	}
-	
-	++currentRxBit;	
-	if ((currentRxBit % BITS_PER_BYTE) == 0)
-	{
-		rxBuffer[currentRxByte] = currentRxByteValue;
-		++currentRxByte;
-	}
-	else
-	{
-		currentRxByteValue <<= 1;
-	}
-	
-	if (currentRxBit >= DATA_BITS)
-	{
-		uint8_t i = PACKET_LENGTH_BYTES - 1;
-		do 
-		{
-			rxData[i] = rxBuffer[i];
-		} while (i--);
-		
-		rxComplete = 1;
-		currentRxBit = 0;
-		currentRxByte = 0;
-		preambleCount = 0;
-	}
+	++timerOverflows;
 }
 
 
 ISR(INT0_vect)
 {
 	uint8_t sreg = SREG;
-	uint16_t elapsedTimeTicks = TCNT1 - PRELOAD_800US;
-		
-	/* Reset the timeout on any edge */
-	TCNT1 = PRELOAD_800US;
+	uint16_t time = TCNT1;
 	
-	Uart0SendValue(elapsedTimeTicks);
-	Uart0SendByte('\n');
-	
-	if (preambleCount < PREAMBLE_BITS && elapsedTimeTicks >= PREAMBLE_TICKS)
-	{
-		LED_TOGGLE(LED0_PIN, LED0_PORT);
-		/* Preamble */
-		++preambleCount;
-	}
-	else if (preambleCount == PREAMBLE_BITS && (TCCR1B & (1 << ICES1)) == 0)
-	{
-		LED_TOGGLE(LED1_PIN, LED1_PORT);
-		/* On falling edge, we fetch the measurement result */		
-		if (elapsedTimeTicks >= BIT1_TICKS)
-		{
-			/* 1 Bit */
-			enqueueSample(1);
-		}
-		else if (elapsedTimeTicks >= BIT0_TICKS)
-		{
-			/* 0 Bit */
-			enqueueSample(0);
-		}
-	}
-	
-	/* Toggle interrupt edge bit */	
-	EICRA ^= (1 << ISC00);
+	/*
+	 * Level after the edge. A glitch shorter than the interrupt latency is seen as two edges
+	 * with the same level, the resulting very short pulse is rejected by the decoder.
+	 */
+	capturePush(time, RX_LEVEL());
 	
 	SREG = sreg;
 }
@@ -264,10 +208,82 @@ void assemblePacket(const uint8_t id, const uint8_t batteryLow, const uint8_t te
 }
 
 
-void decodePacket(const uint8_t *data)
+void printBurst(const BresserBurstResult_t *result)
 {
-	uint8_t id = data[0];
+	Uart0SendValue(result->record.id);
+	Uart0SendByte(' ');
+	Uart0SendValue(result->record.batteryLow);
+	Uart0SendByte(' ');
+	Uart0SendValue(result->record.test);
+	Uart0SendByte(' ');
+	Uart0SendValue(result->record.channel);
+	Uart0SendByte(' ');
+	Uart0SendValue(result->record.temperature);
+	Uart0SendByte(' ');
+	Uart0SendValue(result->record.humidity);
+	Uart0SendByte(' ');
+	Uart0SendValue(result->copies);
+	Uart0SendByte('/');
+	Uart0SendValue(result->agreeing);
+	Uart0SendByte('\n');
+}
+
+
+uint32_t getTimerOverflows(void)
+{
+	uint32_t overflows;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		overflows = timerOverflows;
+	}
+	return overflows;
+}
+
+
+void processCaptures(BresserDecoder_t *decoder, BresserBurst_t *burst)
+{
+	static uint16_t lastCaptureTime = 0;
+	BresserFrame_t frame;
+	BresserBurstResult_t result;
 	
+	uint16_t time;
+	uint8_t level;
+	
+	while (capturePop(&time, &level))
+	{
+		if (level & CAPTURE_LOST_EDGES)
+		{
+			bresserDecoderReset(decoder);
+		}
+		
+		/* The pulse before this edge had the opposite level */
+		if (bresserDecoderPulse(decoder, !(level & 1), time - lastCaptureTime, &frame)
+			&& bresserBurstFrame(burst, &frame, getTimerOverflows(), &result))
+		{
+			printBurst(&result);
+		}
+		lastCaptureTime = time;
+	}
+	
+	if (bresserBurstPoll(burst, getTimerOverflows(), &result))
+	{
+		printBurst(&result);
+	}
+}
+
+
+void sleepUntilCapture(void)
+{
+	/* Check and sleep with interrupts disabled, an edge in between would otherwise wait for the next wakeup */
+	cli();
+	if (captureEmpty())
+	{
+		sleep_enable();
+		sei();		/* The instruction after SEI is executed before any pending interrupt */
+		sleep_cpu();
+		sleep_disable();
+	}
+	sei();
 }
 
 
@@ -280,16 +296,33 @@ int main(void)
 	uint8_t channel = 2;
 	uint8_t humidity = 55;
 	uint16_t temperature = 222;
+	uint16_t overflows;
+	uint16_t reportedOverflows = 0;
+	BresserDecoder_t decoder;
+	BresserBurst_t burst;
+	
+	// Power reduction
+	ACSR = (1 << ACD);	// Analog Comparator off
+	PRR0 |= (1 << PRTWI0) | (1 << PRTIM2) | (1 << PRUSART1) | (1 << PRSPI0) | (1 << PRADC);
+	PRR1 |= (1 << PRPTC) | (1 << PRTIM4) | (1 << PRSPI1) | (1 << PRTIM3) | (1 << PRTWI1);
 	
 	DDRB |= LED0_PIN;
 	DDRC |= TX_PIN | LED1_PIN;
 	
 	TIMSK0 = (1 << TOIE0);
 	
-	TCNT1 = PRELOAD_800US;
-	TCCR1B = (1 << ICES1) | (4 << CS10); /* Clk/256 */
+	bresserDecoderInit(&decoder, BRESSER_BIT_PERIOD_US / CAPTURE_TICK_US);
+	bresserBurstInit(&burst, BURST_GAP_OVERFLOWS);
+	
+	/* Free running, timestamps only */
+	TCCR1B = (2 << CS10); /* Clk/8 */
 	TIMSK1 = (1 << TOIE1);
-	/* Intentionally leave EXTINT unset to trigger an initialization timeout */
+	
+	EICRA = (ANY_EDGE_INT << ISC00);
+	EIFR = (1 << INTF0);
+	EIMSK = (1 << INT0);
+	
+	set_sleep_mode(SLEEP_MODE_IDLE);
 	
 	EnableSerialDebugging();
 	
@@ -310,15 +343,18 @@ int main(void)
 			_delay_ms(100);
 		}
 		
-		if (rxComplete)
+		processCaptures(&decoder, &burst);
+		
+		overflows = captureGetOverflows();
+		if (overflows != reportedOverflows)
 		{
-			for (uint8_t i = 0; i < PACKET_LENGTH_BYTES; i++)
-			{
-				Uart0SendByteHex(rxData[i]);
-			}
+			reportedOverflows = overflows;
+			TRACE("FIFOovf ");
+			Uart0SendValue(overflows);
 			Uart0SendByte('\n');
-			rxComplete = 0;
 		}
+		
+		sleepUntilCapture();
     }
 	
 	return 0;
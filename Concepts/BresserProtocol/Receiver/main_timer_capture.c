@@ -10,8 +10,13 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include <util/delay.h>
-#include <stdlib.h>
-#include "SerialDebug.h"
+#include <util/atomic.h>
+#include <stdlib.h>
+#include "SerialDebug.h"
+#include "CaptureFifo.h"
+#include "../Decoder/BresserDecoder.h"
+#include "../Decoder/BresserBurst.h"
+#include "../Decoder/BresserSensorTable.h"
 
 #define SW0_PIN					(1 << PB7)
 #define SW0_PRESSED				((PINB & SW0_PIN) == 0)
@@ -55,114 +60,48 @@
 	TX_PIN_LOW(); \
 }
 
-#define PRELOAD_800US			0xFFE7
-#define PREAMBLE_TICKS			20
-#define BIT1_TICKS				14
-#define BIT0_TICKS				7
+#define CAPTURE_TICK_US			1		/* Timer1 @ Clk/8 */
+#define TIMER1_OVERFLOW_MS		66		/* 65536 ticks, coarse clock for burst completion */
+#define BURST_GAP_OVERFLOWS		((BRESSER_BURST_GAP_MS + TIMER1_OVERFLOW_MS - 1) / TIMER1_OVERFLOW_MS)
+
+//#define GATEWAY_MODE							/* Track all sensors in range and dump the table periodically instead of printing every burst */
+#define GATEWAY_DUMP_OVERFLOWS	(60000UL / TIMER1_OVERFLOW_MS)		/* ~60 s */
+#define GATEWAY_STALE_OVERFLOWS	(600000UL / TIMER1_OVERFLOW_MS)		/* Sensors silent for ~10 min may be evicted */
 
 
 volatile uint8_t txBuffer[PACKET_LENGTH_BYTES];
 volatile uint8_t currentByte;
 volatile uint8_t currentBit;
 
-volatile uint8_t rxBuffer[PACKET_LENGTH_BYTES];
-volatile uint8_t rxData[PACKET_LENGTH_BYTES];
-volatile uint8_t currentRxByte;
-volatile uint8_t currentRxBit;
-volatile uint8_t rxComplete;
-volatile uint8_t preambleCount;
-volatile uint8_t currentRxByteValue;
-
-
-ISR(TIMER1_OVF_vect)
-{
-	/* timeout occured */
-	TCNT1 = PRELOAD_800US;
-	TCCR1B |= (1 << ICES1);
-	TIMSK1 |= (1 << ICIE1);
-	preambleCount = 0;
-	currentRxBit = 0;
-	currentRxByte = 0;
-	rxComplete = 0;	
-	currentRxByteValue = 0;
-}
-
-
-void enqueueSample(const uint8_t bitValue)
-{
-	if (bitValue == 1)
-	{		
-		currentRxByteValue |= 1;
-	}
-	else if (bitValue == 0)
-	{		
-		currentRxByteValue &= ~1;
-	}
-	
-	++currentRxBit;	
-	if ((currentRxBit % BITS_PER_BYTE) == 0)
-	{
-		rxBuffer[currentRxByte] = currentRxByteValue;
-		++currentRxByte;
-	}
-	else
-	{
-		currentRxByteValue <<= 1;
-	}
-	
-	if (currentRxBit >= DATA_BITS)
-	{
-		if (rxComplete == 0)
-		{		
-			uint8_t i = PACKET_LENGTH_BYTES - 1;
-			do
-			{
-				rxData[i] = rxBuffer[i];
-			} while (i--);			
-			rxComplete = 1;
-		}
-		currentRxBit = 0;
-		currentRxByte = 0;
-		preambleCount = 0;
-	}
-}
-
-
-ISR(TIMER1_CAPT_vect)
-{
-	uint8_t sreg = SREG;
-	uint16_t elapsedTimeTicks = ICR1 - PRELOAD_800US;
-	
-	/* Reset the timeout on any edge */
-	TCNT1 = PRELOAD_800US;
-	
-	if (preambleCount < PREAMBLE_BITS && elapsedTimeTicks >= PREAMBLE_TICKS)
-	{
-		/* Preamble */
-		++preambleCount;
-	}
-	else if (preambleCount == PREAMBLE_BITS && (TCCR1B & (1 << ICES1)) == 0)
-	{		
-		/* On falling edge, we fetch the measurement result */		
-		if (elapsedTimeTicks >= BIT1_TICKS)
-		{
-			/* 1 Bit */
-			enqueueSample(1);
-		}
-		else if (elapsedTimeTicks >= BIT0_TICKS)
-		{
-			/* 0 Bit */
-			enqueueSample(0);
-		}
-	}
-	
-	/* Toggle input detection edge */
-	TCCR1B ^= (1 << ICES1);
-	
-	SREG = sreg;
-}
-
-
+volatile uint32_t timerOverflows;
+
+#ifdef GATEWAY_MODE
+BresserTable_t sensorTable;
+#endif
+
+
+ISR(TIMER1_OVF_vect)
+{
+	++timerOverflows;
+}
+
+
+ISR(TIMER1_CAPT_vect)
+{
+	uint8_t sreg = SREG;
+	uint16_t time = ICR1;
+	uint8_t level = ((TCCR1B & (1 << ICES1)) != 0);
+	
+	/* Toggle input detection edge */
+	TCCR1B ^= (1 << ICES1);
+	
+	/* Just store the timestamp, decoding is done in main() */
+	capturePush(time, level);
+	
+	SREG = sreg;
+}
+
+
 ISR(TIMER0_OVF_vect)
 {
 	static uint8_t temp = 0;
@@ -238,18 +177,6 @@ inline uint16_t fahrenheitToRaw(const int16_t in)
 }
 
 
-inline int16_t rawToFahrenheit(const uint16_t in)
-{
-	return in - 900;
-}
-
-
-inline int16_t fahrenheitToCentigrade(const int16_t in)
-{
-	return (in - 320) * 10 / 18;
-}
-
-
 void assemblePacket(const uint8_t id, const uint8_t batteryLow, const uint8_t test, const uint8_t channel, const int16_t temperature, const uint8_t humidity)
 {	
 	if ((channel == 0) || (humidity > 100) || (temperature < -677) || (temperature > 1590))
@@ -268,77 +195,130 @@ void assemblePacket(const uint8_t id, const uint8_t batteryLow, const uint8_t te
 }
 
 
-void decodePacket(volatile uint8_t *data)
-{
-	uint8_t check = (data[0] + data[1] + data[2] + data[3] - data[4]) % 256;
-	if (check != 0)
-	{
-		Uart0SendString("CHKinv!\n");
-		return;
-	}
-	
-	uint8_t id = data[0];
-	uint8_t batteryLow = ((data[1] >> 7) &  0x1);
-	uint8_t test = ((data[1] >> 6) & 0x1);
-	uint8_t channel = ((data[1] >> 4) & 0x3);
-	int16_t temperature = fahrenheitToCentigrade(rawToFahrenheit((data[1] & 0xF) * 256 + data[2]));
-	uint8_t humidity = data[3];
-	
-	Uart0SendValue(id);
-	Uart0SendByte(' ');
-	Uart0SendValue(batteryLow);
-	Uart0SendByte(' ');
-	Uart0SendValue(test);
-	Uart0SendByte(' ');
-	Uart0SendValue(channel);
-	Uart0SendByte(' ');
-	Uart0SendValue(temperature);
-	Uart0SendByte(' ');
-	Uart0SendValue(humidity);
-	Uart0SendByte('\n');
-}
-
-
-void decodePacket2(const uint8_t *data, uint8_t *id, uint8_t *batteryLow, uint8_t *test, uint8_t *channel, int16_t *temperature, uint8_t *humidity)
-{
-	uint8_t check = (data[0] + data[1] + data[2] + data[3] - data[4]) % 256;
-	if (check != 0)
-	{
-		return;
-	}
-	
-	if (id)
-	{
-		*id = data[0];
-	}
-	
-	if (batteryLow)
-	{
-		*batteryLow = ((data[1] >> 7) &  0x1);
-	}
-	
-	if (test)
-	{
-		*test = ((data[1] >> 6) & 0x1);
-	}
-	
-	if (channel)
-	{
-		*channel = ((data[1] >> 4) & 0x3);
-	}
-	
-	if (temperature)
-	{
-		*temperature = fahrenheitToCentigrade(rawToFahrenheit(data[1] & 0xF) * 256 + data[2]);
-	}
-	
-	if (humidity)
-	{
-		*humidity = data[3];		
-	}
-}
-
-
+void printBurst(const BresserBurstResult_t *result)
+{
+	Uart0SendValue(result->record.id);
+	Uart0SendByte(' ');
+	Uart0SendValue(result->record.batteryLow);
+	Uart0SendByte(' ');
+	Uart0SendValue(result->record.test);
+	Uart0SendByte(' ');
+	Uart0SendValue(result->record.channel);
+	Uart0SendByte(' ');
+	Uart0SendValue(result->record.temperature);
+	Uart0SendByte(' ');
+	Uart0SendValue(result->record.humidity);
+	Uart0SendByte(' ');
+	Uart0SendValue(result->copies);
+	Uart0SendByte('/');
+	Uart0SendValue(result->agreeing);
+	Uart0SendByte('\n');
+}
+
+
+#ifdef GATEWAY_MODE
+void printSensorTable(uint32_t now)
+{
+	TRACE("--- ");
+	Uart0SendValue(sensorTable.count);
+	Uart0SendByte('/');
+	Uart0SendValue(sensorTable.evictions);
+	Uart0SendByte('\n');
+	
+	for (uint8_t i = 0; i < BRESSER_TABLE_SIZE; i++)
+	{
+		const BresserSensor_t *sensor = &sensorTable.sensors[i];
+		if (!sensor->used)
+		{
+			continue;
+		}
+		Uart0SendValue(sensor->id);
+		Uart0SendByte(' ');
+		Uart0SendValue(sensor->channel);
+		Uart0SendByte(' ');
+		Uart0SendValue(sensor->last.temperature);
+		Uart0SendByte(' ');
+		Uart0SendValue(sensor->last.humidity);
+		Uart0SendByte(' ');
+		Uart0SendValue(sensor->last.batteryLow);
+		Uart0SendByte(' ');
+		/* Age in seconds */
+		Uart0SendValue((now - sensor->lastSeen) * TIMER1_OVERFLOW_MS / 1000);
+		Uart0SendByte(' ');
+		Uart0SendValue(sensor->bursts);
+		Uart0SendByte(' ');
+		Uart0SendValue(sensor->badFrames);
+		Uart0SendByte('/');
+		Uart0SendValue(sensor->frames);
+		Uart0SendByte(' ');
+		/* Clock drift: measured bit period [us] */
+		Uart0SendValue(sensor->bitPeriodMin);
+		Uart0SendByte('/');
+		Uart0SendValue(sensor->bitPeriod);
+		Uart0SendByte('/');
+		Uart0SendValue(sensor->bitPeriodMax);
+		Uart0SendByte('\n');
+	}
+}
+#endif
+
+
+uint32_t getTimerOverflows(void)
+{
+	uint32_t overflows;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		overflows = timerOverflows;
+	}
+	return overflows;
+}
+
+
+void handleBurst(const BresserBurstResult_t *result)
+{
+#ifdef GATEWAY_MODE
+	bresserTableUpdate(&sensorTable, result, getTimerOverflows());
+#else
+	printBurst(result);
+#endif
+}
+
+
+void processCaptures(BresserDecoder_t *decoder, BresserBurst_t *burst)
+{
+	static uint16_t lastCaptureTime = 0;
+	BresserFrame_t frame;
+	BresserBurstResult_t result;
+	
+	uint16_t time;
+	uint8_t level;
+	
+	while (capturePop(&time, &level))
+	{
+		if (level & CAPTURE_LOST_EDGES)
+		{
+			bresserDecoderReset(decoder);
+		}
+		
+		/*
+		 * The pulse before this edge had the opposite level.
+		 * Gaps > 65 ms wrap around - at worst one bogus pulse in front of a preamble.
+		 */
+		if (bresserDecoderPulse(decoder, !(level & 1), time - lastCaptureTime, &frame)
+			&& bresserBurstFrame(burst, &frame, getTimerOverflows(), &result))
+		{
+			handleBurst(&result);
+		}
+		lastCaptureTime = time;
+	}
+	
+	if (bresserBurstPoll(burst, getTimerOverflows(), &result))
+	{
+		handleBurst(&result);
+	}
+}
+
+
 int main(void)
 {
 	uint8_t packetCount = 0;
@@ -347,16 +327,27 @@ int main(void)
 	uint8_t testButtonPressed = 1;
 	uint8_t channel = 2;
 	uint8_t humidity = 55;
-	uint16_t temperature = 222;
+	uint16_t temperature = 222;
+	uint16_t overflows;
+	uint16_t reportedOverflows = 0;
+	BresserDecoder_t decoder;
+	BresserBurst_t burst;
 	
 	DDRB |= LED0_PIN;
 	DDRC |= TX_PIN | LED1_PIN;
 	
 	TIMSK0 = (1 << TOIE0);
 	
-	TCNT1 = PRELOAD_800US;
-	TCCR1B = (1 << ICES1) | (4 << CS10); /* Clk/256 */
-	TIMSK1 = (1 << TOIE1); /* Intentionally leave Input Capture Interrupt unset to trigger an initialization timeout */
+	bresserDecoderInit(&decoder, BRESSER_BIT_PERIOD_US / CAPTURE_TICK_US);
+	bresserBurstInit(&burst, BURST_GAP_OVERFLOWS);
+#ifdef GATEWAY_MODE
+	bresserTableInit(&sensorTable, GATEWAY_STALE_OVERFLOWS);
+	uint32_t lastDump = 0;
+#endif
+	
+	/* Free running, timestamps only */
+	TCCR1B = (1 << ICES1) | (2 << CS10); /* Clk/8 */
+	TIMSK1 = (1 << ICIE1) | (1 << TOIE1);
 	
 	EnableSerialDebugging();
 	
@@ -377,16 +368,25 @@ int main(void)
 			_delay_ms(100);
 		}
 		
-		if (rxComplete)
-		{
-			for (uint8_t i = 0; i < PACKET_LENGTH_BYTES; i++)
-			{
-				Uart0SendByteHex(rxData[i]);
-			}
-			Uart0SendByte('\n');
-			decodePacket(rxData);
-			rxComplete = 0;
-		}
+		processCaptures(&decoder, &burst);
+		
+		overflows = captureGetOverflows();
+		if (overflows != reportedOverflows)
+		{
+			reportedOverflows = overflows;
+			TRACE("FIFOovf ");
+			Uart0SendValue(overflows);
+			Uart0SendByte('\n');
+		}
+		
+#ifdef GATEWAY_MODE
+		uint32_t now = getTimerOverflows();
+		if (now - lastDump >= GATEWAY_DUMP_OVERFLOWS)
+		{
+			lastDump = now;
+			printSensorTable(now);
+		}
+#endif
     }
 	
 	return 0;
@@ -30,6 +30,14 @@ courtesy of Brian McNoldy at http://andrew.rsmas.miami.edu.
 
 #include "BME280.h"
 #include <math.h>
+#include <string.h>
+
+#ifdef BME280_TRIM_CACHE
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+
+BME280::TrimCache EEMEM BME280::s_trimCache;
+#endif
 
 /****************************************************************/
 BME280::BME280
@@ -76,8 +84,8 @@ void BME280::InitializeFilter()
 
   WriteSettings();
 
-  float dummy;
-  read(dummy, dummy, dummy);
+  Data dummy;
+  read(dummy);
 
   m_settings.filter = filter;
 }
@@ -172,6 +180,13 @@ bool BME280::ReadTrim()
    uint8_t ord(0);
    bool success = true;
 
+#ifdef BME280_TRIM_CACHE
+   if (ReadTrimCache())
+   {
+      return true;
+   }
+#endif
+
    // Temp. Dig
    success &= ReadRegister(TEMP_DIG_ADDR, &m_dig[ord], TEMP_DIG_LENGTH);
    ord += TEMP_DIG_LENGTH;
@@ -198,10 +213,154 @@ bool BME280::ReadTrim()
    Serial.println();
 #endif
 
+#ifdef BME280_TRIM_CACHE
+   if (success)
+   {
+      WriteTrimCache();
+   }
+#endif
+
    return success && ord == DIG_LENGTH;
 }
 
 
+#ifdef BME280_TRIM_CACHE
+/****************************************************************/
+static uint8_t TrimCacheCrc
+(
+   uint8_t chipModel,
+   const uint8_t dig[],
+   uint8_t length
+)
+{
+   uint8_t crc = _crc8_ccitt_update(0, chipModel);
+
+   for(uint8_t i = 0; i < length; ++i)
+   {
+      crc = _crc8_ccitt_update(crc, dig[i]);
+   }
+   return crc;
+}
+
+
+/****************************************************************/
+bool BME280::ReadTrimCache()
+{
+   TrimCache cache;
+   uint8_t tempDig[TEMP_DIG_LENGTH];
+
+   eeprom_read_block(&cache, &s_trimCache, sizeof(cache));
+
+   // Erased (0xFF), written by another chip model or corrupted
+   if (cache.chipModel != m_chip_model ||
+       cache.crc != TrimCacheCrc(cache.chipModel, cache.dig, DIG_LENGTH))
+   {
+      return false;
+   }
+
+   // The chip ID is the same for every BME280, the temperature trim is unique enough
+   // to detect a replaced sensor and costs one short read instead of the full trim.
+   if (!ReadRegister(TEMP_DIG_ADDR, tempDig, TEMP_DIG_LENGTH) ||
+       memcmp(tempDig, cache.dig, TEMP_DIG_LENGTH) != 0)
+   {
+      return false;
+   }
+
+   memcpy(m_dig, cache.dig, DIG_LENGTH);
+   return true;
+}
+
+
+/****************************************************************/
+void BME280::WriteTrimCache()
+{
+   TrimCache cache;
+
+   cache.chipModel = m_chip_model;
+   memcpy(cache.dig, m_dig, DIG_LENGTH);
+   cache.crc = TrimCacheCrc(cache.chipModel, cache.dig, DIG_LENGTH);
+
+   // Only changed bytes are written
+   eeprom_update_block(&cache, &s_trimCache, sizeof(cache));
+}
+#endif
+
+
+/****************************************************************/
+bool BME280::startMeasurement()
+{
+   uint8_t ctrlHum, ctrlMeas, config;
+
+   // ctrl_hum and config are retained in forced mode (written in WriteSettings()),
+   // writing ctrl_meas alone starts the next conversion.
+   CalculateRegisters(ctrlHum, ctrlMeas, config);
+
+   return WriteRegister(CTRL_MEAS_ADDR, ctrlMeas);
+}
+
+
+/****************************************************************/
+uint32_t BME280::measurementTime()
+{
+   // t_measure,max = 1.25 + 2.3 * T_osr + (2.3 * P_osr + 0.575) + (2.3 * H_osr + 0.575) ms,
+   // the terms of skipped measurements are omitted. OSR_Xn is encoded as log2(n) + 1.
+   uint32_t time = 1250;
+
+   if (m_settings.tempOSR != OSR_Off)
+   {
+      time += 2300UL << (m_settings.tempOSR - 1);
+   }
+   if (m_settings.presOSR != OSR_Off)
+   {
+      time += (2300UL << (m_settings.presOSR - 1)) + 575;
+   }
+   if (m_settings.humOSR != OSR_Off)
+   {
+      time += (2300UL << (m_settings.humOSR - 1)) + 575;
+   }
+
+   return time;
+}
+
+
+/****************************************************************/
+bool BME280::Measure()
+{
+   uint8_t status;
+
+   if (m_settings.mode != Mode_Forced)
+   {
+      return true;
+   }
+
+   if (!startMeasurement())
+   {
+      return false;
+   }
+
+   // Blocking variant, callers which want to sleep instead use measurementTime().
+   // The margin covers the tolerance of the MCU clock the delay is based on, the
+   // time spent on the bus only makes the actual wait longer.
+   uint32_t timeout = measurementTime() + measurementTime() / 4;
+   for (uint32_t waited = 0; ; waited += STATUS_POLL_INTERVAL_US)
+   {
+      if (!ReadRegister(STATUS_ADDR, &status, 1))
+      {
+         return false;
+      }
+      if ((status & STATUS_MEASURING) == 0)
+      {
+         return true;
+      }
+      if (waited >= timeout)
+      {
+         return false;
+      }
+      DelayUs(STATUS_POLL_INTERVAL_US);
+   }
+}
+
+
 /****************************************************************/
 bool BME280::ReadData
 (
@@ -211,12 +370,6 @@ bool BME280::ReadData
    bool success;
    uint8_t buffer[SENSOR_DATA_LENGTH];
 
-   // For forced mode we need to write the mode to BME280 register before reading
-   if (m_settings.mode == Mode_Forced)
-   {
-      WriteSettings();
-   }
-
    // Registers are in order. So we can start at the pressure register and read 8 bytes.
    success = ReadRegister(PRESS_ADDR, buffer, SENSOR_DATA_LENGTH);
 
@@ -240,28 +393,26 @@ bool BME280::ReadData
 
 
 /****************************************************************/
-float BME280::CalculateTemperature
+int32_t BME280::CompensateTemperature
 (
    int32_t raw,
-   int32_t& t_fine,
-   TempUnit unit
+   int32_t& t_fine
 )
 {
    // Code based on calibration algorthim provided by Bosch.
-   int32_t var1, var2, final;
+   int32_t var1, var2;
    uint16_t dig_T1 = (m_dig[1] << 8) | m_dig[0];
    int16_t   dig_T2 = (m_dig[3] << 8) | m_dig[2];
    int16_t   dig_T3 = (m_dig[5] << 8) | m_dig[4];
    var1 = ((((raw >> 3) - ((int32_t)dig_T1 << 1))) * ((int32_t)dig_T2)) >> 11;
    var2 = (((((raw >> 4) - ((int32_t)dig_T1)) * ((raw >> 4) - ((int32_t)dig_T1))) >> 12) * ((int32_t)dig_T3)) >> 14;
    t_fine = var1 + var2;
-   final = (t_fine * 5 + 128) >> 8;
-   return unit == TempUnit_Celsius ? final/100.0 : final/100.0*9.0/5.0 + 32.0;
+   return (t_fine * 5 + 128) >> 8;
 }
 
 
 /****************************************************************/
-float BME280::CalculateHumidity
+uint32_t BME280::CompensateHumidity
 (
    int32_t raw,
    int32_t t_fine
@@ -272,8 +423,9 @@ float BME280::CalculateHumidity
    uint8_t   dig_H1 =   m_dig[24];
    int16_t dig_H2 = (m_dig[26] << 8) | m_dig[25];
    uint8_t   dig_H3 =   m_dig[27];
-   int16_t dig_H4 = (m_dig[28] << 4) | (0x0F & m_dig[29]);
-   int16_t dig_H5 = (m_dig[30] << 4) | ((m_dig[29] >> 4) & 0x0F);
+   // H4/H5 are signed 12 bit, the MSB register carries the sign.
+   int16_t dig_H4 = ((int16_t)(int8_t)m_dig[28] << 4) | (0x0F & m_dig[29]);
+   int16_t dig_H5 = ((int16_t)(int8_t)m_dig[30] << 4) | ((m_dig[29] >> 4) & 0x0F);
    int8_t   dig_H6 =   m_dig[31];
 
    var1 = (t_fine - ((int32_t)76800));
@@ -284,22 +436,18 @@ float BME280::CalculateHumidity
    var1 = (var1 - (((((var1 >> 15) * (var1 >> 15)) >> 7) * ((int32_t)dig_H1)) >> 4));
    var1 = (var1 < 0 ? 0 : var1);
    var1 = (var1 > 419430400 ? 419430400 : var1);
-   return ((uint32_t)(var1 >> 12))/1024.0;
+   return (uint32_t)(var1 >> 12);
 }
 
 
 /****************************************************************/
-float BME280::CalculatePressure
+uint32_t BME280::CompensatePressure
 (
    int32_t raw,
-   int32_t t_fine,
-   PresUnit unit
+   int32_t t_fine
 )
 {
    // Code based on calibration algorthim provided by Bosch.
-   int64_t var1, var2, pressure;
-   float final;
-
    uint16_t dig_P1 = (m_dig[7]   << 8) | m_dig[6];
    int16_t   dig_P2 = (m_dig[9]   << 8) | m_dig[8];
    int16_t   dig_P3 = (m_dig[11] << 8) | m_dig[10];
@@ -310,20 +458,120 @@ float BME280::CalculatePressure
    int16_t   dig_P8 = (m_dig[21] << 8) | m_dig[20];
    int16_t   dig_P9 = (m_dig[23] << 8) | m_dig[22];
 
+#ifdef BME280_PRESSURE_64BIT
+   int64_t var1, var2, pressure;
+
    var1 = (int64_t)t_fine - 128000;
    var2 = var1 * var1 * (int64_t)dig_P6;
    var2 = var2 + ((var1 * (int64_t)dig_P5) << 17);
    var2 = var2 + (((int64_t)dig_P4) << 35);
    var1 = ((var1 * var1 * (int64_t)dig_P3) >> 8) + ((var1 * (int64_t)dig_P2) << 12);
    var1 = (((((int64_t)1) << 47) + var1)) * ((int64_t)dig_P1) >> 33;
-   if (var1 == 0) { return NAN; }                                                         // Don't divide by zero.
+   if (var1 == 0) { return 0; }                                                           // Don't divide by zero.
    pressure   = 1048576 - raw;
    pressure = (((pressure << 31) - var2) * 3125)/var1;
    var1 = (((int64_t)dig_P9) * (pressure >> 13) * (pressure >> 13)) >> 25;
    var2 = (((int64_t)dig_P8) * pressure) >> 19;
    pressure = ((pressure + var1 + var2) >> 8) + (((int64_t)dig_P7) << 4);
 
-   final = ((uint32_t)pressure)/256.0;
+   return (uint32_t)pressure;
+#else
+   // 32 bit variant, 1 Pa resolution. Avoids the 64 bit multiplication and division
+   // (library code and thousands of cycles on 8 bit MCUs).
+   int32_t var1, var2;
+   uint32_t pressure;
+
+   var1 = (t_fine >> 1) - (int32_t)64000;
+   var2 = (((var1 >> 2) * (var1 >> 2)) >> 11) * ((int32_t)dig_P6);
+   var2 = var2 + ((var1 * ((int32_t)dig_P5)) << 1);
+   var2 = (var2 >> 2) + (((int32_t)dig_P4) << 16);
+   var1 = ((((int32_t)dig_P3 * (((var1 >> 2) * (var1 >> 2)) >> 13)) >> 3) + ((((int32_t)dig_P2) * var1) >> 1)) >> 18;
+   var1 = (((int32_t)32768 + var1) * ((int32_t)dig_P1)) >> 15;
+   if (var1 == 0) { return 0; }                                                           // Don't divide by zero.
+   pressure = (((uint32_t)((int32_t)1048576 - raw)) - (uint32_t)(var2 >> 12)) * 3125;
+   if (pressure < 0x80000000)
+   {
+      pressure = (pressure << 1) / ((uint32_t)var1);
+   }
+   else
+   {
+      pressure = (pressure / (uint32_t)var1) * 2;
+   }
+   var1 = (((int32_t)dig_P9) * ((int32_t)(((pressure >> 3) * (pressure >> 3)) >> 13))) >> 12;
+   var2 = (((int32_t)(pressure >> 2)) * ((int32_t)dig_P8)) >> 13;
+   pressure = (uint32_t)((int32_t)pressure + ((var1 + var2 + dig_P7) >> 4));
+
+   return pressure << 8;
+#endif
+}
+
+
+/****************************************************************/
+bool BME280::read
+(
+   Data& data
+)
+{
+   return Measure() && readMeasurement(data);
+}
+
+
+/****************************************************************/
+bool BME280::readMeasurement
+(
+   Data& data
+)
+{
+   int32_t raw[8];
+   int32_t t_fine;
+   if(!ReadData(raw)){ return false; }
+   int32_t rawPressure = (raw[0] << 12) | (raw[1] << 4) | (raw[2] >> 4);
+   int32_t rawTemp = (raw[3] << 12) | (raw[4] << 4) | (raw[5] >> 4);
+   int32_t rawHumidity = (raw[6] << 8) | raw[7];
+   data.temperature = CompensateTemperature(rawTemp, t_fine);
+   data.pressure = CompensatePressure(rawPressure, t_fine);
+   data.humidity = CompensateHumidity(rawHumidity, t_fine);
+   return true;
+}
+
+
+#ifndef BME280_FIXED_POINT
+/****************************************************************/
+float BME280::CalculateTemperature
+(
+   int32_t raw,
+   int32_t& t_fine,
+   TempUnit unit
+)
+{
+   int32_t final = CompensateTemperature(raw, t_fine);
+   return unit == TempUnit_Celsius ? final/100.0 : final/100.0*9.0/5.0 + 32.0;
+}
+
+
+/****************************************************************/
+float BME280::CalculateHumidity
+(
+   int32_t raw,
+   int32_t t_fine
+)
+{
+   return CompensateHumidity(raw, t_fine)/1024.0;
+}
+
+
+/****************************************************************/
+float BME280::CalculatePressure
+(
+   int32_t raw,
+   int32_t t_fine,
+   PresUnit unit
+)
+{
+   uint32_t pressure = CompensatePressure(raw, t_fine);
+   if (pressure == 0) { return NAN; }
+
+   float final = pressure/256.0;
 
    // Conversion units courtesy of www.endmemo.com.
    switch(unit){
@@ -360,7 +608,7 @@ float BME280::temp
 {
    int32_t data[8];
    int32_t t_fine;
-   if(!ReadData(data)){ return NAN; }
+   if(!Measure() || !ReadData(data)){ return NAN; }
    uint32_t rawTemp   = (data[3] << 12) | (data[4] << 4) | (data[5] >> 4);
    return CalculateTemperature(rawTemp, t_fine, unit);
 }
@@ -374,7 +622,7 @@ float BME280::pres
 {
    int32_t data[8];
    int32_t t_fine;
-   if(!ReadData(data)){ return NAN; }
+   if(!Measure() || !ReadData(data)){ return NAN; }
    uint32_t rawTemp       = (data[3] << 12) | (data[4] << 4) | (data[5] >> 4);
    uint32_t rawPressure = (data[0] << 12) | (data[1] << 4) | (data[2] >> 4);
    CalculateTemperature(rawTemp, t_fine);
@@ -387,7 +635,7 @@ float BME280::hum()
 {
    int32_t data[8];
    int32_t t_fine;
-   if(!ReadData(data)){ return NAN; }
+   if(!Measure() || !ReadData(data)){ return NAN; }
    uint32_t rawTemp = (data[3] << 12) | (data[4] << 4) | (data[5] >> 4);
    uint32_t rawHumidity = (data[6] << 8) | data[7];
    CalculateTemperature(rawTemp, t_fine);
@@ -407,7 +655,7 @@ void BME280::read
 {
    int32_t data[8];
    int32_t t_fine;
-   if(!ReadData(data)){
+   if(!Measure() || !ReadData(data)){
       pressure = temp = humidity = NAN;
       return;
    }
@@ -418,6 +666,7 @@ void BME280::read
    pressure = CalculatePressure(rawPressure, t_fine, presUnit);
    humidity = CalculateHumidity(rawHumidity, t_fine);
 }
+#endif
 
 
 /****************************************************************/
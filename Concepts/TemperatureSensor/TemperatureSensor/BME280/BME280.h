@@ -32,6 +32,7 @@ This header must be included in any derived code or copies of the code.
 #define TG_BME_280_H
 
 #include <stdint.h>
+#include "BME280config.h"
 
 //////////////////////////////////////////////////////////////////
 /// BME280 - Driver class for Bosch Bme280 sensor
@@ -146,6 +147,13 @@ public:
       SpiEnable spiEnable;
    };
 
+   struct Data
+   {
+      int32_t  temperature;   ///< 0.01 °C
+      uint32_t pressure;      ///< Pa in Q24.8 (1/256 Pa)
+      uint32_t humidity;      ///< %RH in Q22.10 (1/1024 %RH)
+   };
+
 /*****************************************************************/
 /* INIT FUNCTIONS                                                */
 /*****************************************************************/
@@ -164,6 +172,31 @@ public:
 /* ENVIRONMENTAL FUNCTIONS                                       */
 /*****************************************************************/
 
+   /////////////////////////////////////////////////////////////////
+   /// Read the data from the BME280 in fixed-point (Bosch integer
+   /// compensation), return true if successful. In forced mode a
+   /// measurement is triggered and the status is polled until done.
+   bool   read(
+      Data&     data);
+
+   /////////////////////////////////////////////////////////////////
+   /// Trigger a forced mode measurement with a single write of
+   /// ctrl_meas, return true if successful.
+   bool startMeasurement();
+
+   /////////////////////////////////////////////////////////////////
+   /// Maximum measurement time [us] for the current oversampling
+   /// settings (datasheet, appendix B), the caller can sleep this
+   /// long after startMeasurement() and then readMeasurement().
+   uint32_t measurementTime();
+
+   /////////////////////////////////////////////////////////////////
+   /// Read the result of the last measurement in fixed-point without
+   /// triggering a new one, return true if successful.
+   bool readMeasurement(
+      Data&     data);
+
+#ifndef BME280_FIXED_POINT
    //////////////////////////////////////////////////
    /// Read the temperature from the BME280 and return a float.
    float temp(
@@ -188,6 +221,7 @@ public:
       float&    humidity,
       TempUnit  tempUnit    = TempUnit_Celsius,
       PresUnit  presUnit    = PresUnit_hPa);
+#endif
 
 
 /*****************************************************************/
@@ -235,6 +269,7 @@ private:
 
    static const uint8_t CTRL_HUM_ADDR   = 0xF2;
    static const uint8_t CTRL_MEAS_ADDR  = 0xF4;
+   static const uint8_t STATUS_ADDR     = 0xF3;
    static const uint8_t CONFIG_ADDR     = 0xF5;
    static const uint8_t PRESS_ADDR      = 0xF7;
    static const uint8_t TEMP_ADDR       = 0xFA;
@@ -252,6 +287,9 @@ private:
    static const uint8_t DIG_LENGTH              = 32;
    static const uint8_t SENSOR_DATA_LENGTH      = 8;
 
+   static const uint8_t STATUS_MEASURING        = 0x08;
+   static const uint16_t STATUS_POLL_INTERVAL_US = 500;
+
 
 /*****************************************************************/
 /* VARIABLES                                                     */
@@ -261,6 +299,17 @@ private:
    uint8_t m_dig[32];
    ChipModel m_chip_model;
 
+#ifdef BME280_TRIM_CACHE
+   struct TrimCache
+   {
+      uint8_t chipModel;
+      uint8_t dig[DIG_LENGTH];
+      uint8_t crc;                  ///< CRC-8 over chipModel and dig
+   };
+
+   static TrimCache s_trimCache;    ///< EEPROM
+#endif
+
    bool m_initialized;
 
 
@@ -281,6 +330,11 @@ private:
       uint8_t data[],
       uint8_t length)=0;
 
+   /////////////////////////////////////////////////////////////////
+   /// Busy wait, used between status polls.
+   virtual void DelayUs(
+      uint16_t us)=0;
+
 
 /*****************************************************************/
 /* WORKER FUNCTIONS                                              */
@@ -308,13 +362,53 @@ private:
    /// successful.
    bool ReadTrim();
 
+#ifdef BME280_TRIM_CACHE
+   /////////////////////////////////////////////////////////////////
+   /// Load the trim data from the EEPROM cache, return true if the
+   /// cache is intact and belongs to the connected chip.
+   bool ReadTrimCache();
+
+   /////////////////////////////////////////////////////////////////
+   /// Store the trim data in the EEPROM cache.
+   void WriteTrimCache();
+#endif
+
+   /////////////////////////////////////////////////////////////////
+   /// In forced mode, trigger a measurement and poll the status
+   /// until it is done, at most measurementTime() plus 25 %.
+   /// Return true if successful.
+   bool Measure();
+
    /////////////////////////////////////////////////////////////////
-   /// Read the raw data from the BME280 into an array and return
-   /// true if successful.
+   /// Read the raw data from the BME280 (0xF7..0xFE, one 8 byte
+   /// burst) into an array and return true if successful.
    bool ReadData(
       int32_t data[8]);
 
 
+   /////////////////////////////////////////////////////////////////
+   /// Calculate the temperature from the BME280 raw data and
+   /// BME280 trim in 0.01 °C, t_fine is shared with the pressure
+   /// and humidity compensation.
+   int32_t CompensateTemperature(
+      int32_t raw,
+      int32_t& t_fine);
+
+   /////////////////////////////////////////////////////////////////
+   /// Calculate the humidity from the BME280 raw data and BME280
+   /// trim in %RH Q22.10.
+   uint32_t CompensateHumidity(
+      int32_t raw,
+      int32_t t_fine);
+
+   /////////////////////////////////////////////////////////////////
+   /// Calculate the pressure from the BME280 raw data and BME280
+   /// trim in Pa Q24.8, 0 if the trim is invalid.
+   uint32_t CompensatePressure(
+      int32_t raw,
+      int32_t t_fine);
+
+#ifndef BME280_FIXED_POINT
    /////////////////////////////////////////////////////////////////
    /// Calculate the temperature from the BME280 raw data and
    /// BME280 trim, return a float.
@@ -337,6 +431,7 @@ private:
       int32_t raw,
       int32_t t_fine,
       PresUnit unit = PresUnit_hPa);
+#endif
 
 };
 
@@ -33,6 +33,7 @@ courtesy of Brian McNoldy at http://andrew.rsmas.miami.edu.
 extern "C" {
   #include "twi.h"
 }
+#include <util/delay.h>
 
 /****************************************************************/
 BME280I2C::BME280I2C
@@ -78,9 +79,8 @@ bool BME280I2C::WriteRegister
 )
 {  
   uint8_t txBuffer[2] = { addr, data };
-  twi_writeTo(m_settings.bme280Addr, txBuffer, sizeof(txBuffer), 1, 1);
 
-  return true; // TODO: Check return values from wire calls.
+  return twi_writeTo(m_settings.bme280Addr, txBuffer, sizeof(txBuffer), 1, 1) == 0;
 }
 
 
@@ -92,10 +92,28 @@ bool BME280I2C::ReadRegister
   uint8_t length
 )
 {  
+  // Register address and data read are chained with a repeated START (no STOP in between)
   uint8_t txBuffer[1] = { addr };
-  twi_writeTo(m_settings.bme280Addr, txBuffer, sizeof(txBuffer), 1, 1);
+  if (twi_writeTo(m_settings.bme280Addr, txBuffer, sizeof(txBuffer), 1, 0) != 0)
+  {
+    return false;
+  }
   
   uint8_t rxLength = twi_readFrom(m_settings.bme280Addr, data, length, 1);
 
   return rxLength == length;
 }
+
+
+/****************************************************************/
+void BME280I2C::DelayUs
+(
+  uint16_t us
+)
+{
+  // _delay_us() needs a compile time constant
+  for (; us >= 100; us -= 100)
+  {
+    _delay_us(100);
+  }
+}
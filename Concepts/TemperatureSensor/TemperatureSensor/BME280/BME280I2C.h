@@ -102,5 +102,10 @@ private:
       uint8_t data[],
       uint8_t length);
 
+   /////////////////////////////////////////////////////////////////
+   /// Busy wait in steps of 100 us.
+   void DelayUs(
+      uint16_t us);
+
 };
 #endif // TG_BME_280_I2C_H
@@ -0,0 +1,351 @@
+/*
+
+BME280ReferenceTest.cpp
+
+Host-side agreement test of the integer compensation against the double
+precision reference formulas of the Bosch datasheet (section 8.1), over
+random trim values in the range of real parts and raw values across the
+operating range (-40..85 degC, 300..1100 hPa, 0..100 %RH). Also checks
+that Measure() waits for a conversion with x16 oversampling and gives up on
+a conversion which never finishes. With BME280_TRIM_CACHE, checks that begin()
+takes the trim from the EEPROM cache (only the temperature trim is read over
+the bus) and reads the full trim if the cache is erased, corrupted or belongs
+to another sensor.
+
+Build: g++ -O2 -DBME280_CONFIG_EXTERNAL -DBME280_FIXED_POINT -o BME280ReferenceTest BME280ReferenceTest.cpp BME280.cpp
+       (add -DBME280_PRESSURE_64BIT for the 64-bit pressure formula,
+        -DBME280_TRIM_CACHE -IHostStubs for the trim cache)
+Usage: BME280ReferenceTest [iterations]	(exit code 0 if all deviations are within the limits)
+
+ */
+
+#include "BME280.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Maximum deviation from the reference, well below the sensor accuracy
+// (+-1 degC, +-3 %RH, +-1 hPa absolute / +-0.12 hPa relative).
+static const double TEMPERATURE_LIMIT   = 0.01;   // degC, resolution 0.01
+static const double HUMIDITY_LIMIT      = 0.02;   // %RH
+#ifdef BME280_PRESSURE_64BIT
+static const double PRESSURE_LIMIT      = 0.5;    // Pa
+#else
+static const double PRESSURE_LIMIT      = 8.0;    // Pa, resolution 1 Pa
+#endif
+
+
+//////////////////////////////////////////////////////////////////
+/// Register level stand-in for the sensor, serves a given trim and
+/// raw measurement. A conversion takes conversionUs of simulated time.
+class SimulatedBME280 : public BME280
+{
+public:
+   SimulatedBME280(const Settings& settings = Settings())
+      : BME280(settings), conversionUs(0), nowUs(0), startUs(0), trimBytesRead(0) {}
+
+   uint8_t dig[32];
+   uint8_t raw[8];
+   uint32_t conversionUs;  // UINT32_MAX: never finishes
+   uint32_t nowUs;
+   uint32_t startUs;
+   uint32_t trimBytesRead;
+
+private:
+   virtual bool WriteRegister(uint8_t addr, uint8_t data)
+   {
+      if ((addr == 0xF4) && ((data & 0x03) == Mode_Forced))
+      {
+         startUs = nowUs;
+      }
+      return true;
+   }
+
+   virtual void DelayUs(uint16_t us) { nowUs += us; }
+
+   virtual bool ReadRegister(uint8_t addr, uint8_t data[], uint8_t length)
+   {
+      if ((addr >= 0x88 && addr <= 0xA1) || (addr >= 0xE1 && addr <= 0xE7))
+      {
+         trimBytesRead += length;
+      }
+      switch (addr)
+      {
+         case 0xD0: data[0] = ChipModel_BME280; break;
+         case 0xF3: data[0] = (nowUs - startUs < conversionUs) ? 0x08 : 0; break;
+         case 0x88: memcpy(data, dig, length); break;
+         case 0x8E: memcpy(data, dig + 6, length); break;
+         case 0xA1: memcpy(data, dig + 24, length); break;
+         case 0xE1: memcpy(data, dig + 25, length); break;
+         case 0xF7: memcpy(data, raw, length); break;
+         default: return false;
+      }
+      return true;
+   }
+};
+
+
+struct Trim
+{
+   int T1, T2, T3;
+   int P1, P2, P3, P4, P5, P6, P7, P8, P9;
+   int H1, H2, H3, H4, H5, H6;
+};
+
+
+static int Random(int low, int high)
+{
+   return low + rand() % (high - low + 1);
+}
+
+
+// Conversion with x16 oversampling takes up to 112.8 ms (datasheet 9.1).
+static bool CheckMeasureTimeout()
+{
+   SimulatedBME280 sensor(BME280::Settings(BME280::OSR_X16, BME280::OSR_X16, BME280::OSR_X16));
+   BME280::Data data;
+   uint32_t maximum = sensor.measurementTime();
+
+   sensor.conversionUs = maximum;
+   if (!sensor.begin() || !sensor.read(data))
+   {
+      printf("FAILED, gave up on a %lu us conversion after %lu us\n",
+         (unsigned long)maximum, (unsigned long)(sensor.nowUs - sensor.startUs));
+      return false;
+   }
+
+   sensor.conversionUs = UINT32_MAX;
+   if (sensor.read(data) || (sensor.nowUs - sensor.startUs > maximum * 2))
+   {
+      printf("FAILED, stuck conversion not detected within %lu us\n", (unsigned long)maximum * 2);
+      return false;
+   }
+   return true;
+}
+
+
+static Trim RandomTrim()
+{
+   Trim t;
+   t.T1 = Random(26000, 29000); t.T2 = Random(25000, 27500); t.T3 = Random(-1000, 50);
+   t.P1 = Random(36000, 38500); t.P2 = Random(-11000, -10000); t.P3 = Random(2500, 3500);
+   t.P4 = Random(2000, 9000); t.P5 = Random(-200, 200); t.P6 = Random(-10, 0);
+   t.P7 = Random(9000, 15500); t.P8 = Random(-14600, -9000); t.P9 = Random(4000, 5000);
+   t.H1 = Random(0, 100); t.H2 = Random(330, 400); t.H3 = Random(0, 10);
+   t.H4 = Random(250, 400); t.H5 = Random(-10, 60); t.H6 = Random(20, 40);
+   return t;
+}
+
+
+// Register layout 0x88..0xA1, 0xE1..0xE7
+static void EncodeTrim(const Trim& t, uint8_t dig[32])
+{
+   const int words[12] = { t.T1, t.T2, t.T3, t.P1, t.P2, t.P3, t.P4, t.P5, t.P6, t.P7, t.P8, t.P9 };
+   for (int i = 0; i < 12; ++i)
+   {
+      dig[2 * i] = words[i] & 0xFF;
+      dig[2 * i + 1] = (words[i] >> 8) & 0xFF;
+   }
+   dig[24] = t.H1;
+   dig[25] = t.H2 & 0xFF;
+   dig[26] = (t.H2 >> 8) & 0xFF;
+   dig[27] = t.H3;
+   dig[28] = (t.H4 >> 4) & 0xFF;
+   dig[29] = (t.H4 & 0x0F) | ((t.H5 & 0x0F) << 4);
+   dig[30] = (t.H5 >> 4) & 0xFF;
+   dig[31] = t.H6;
+}
+
+
+// 20 bit pressure and temperature, 16 bit humidity
+static void EncodeRaw(int32_t pressure, int32_t temperature, int32_t humidity, uint8_t raw[8])
+{
+   raw[0] = pressure >> 12; raw[1] = pressure >> 4; raw[2] = (pressure & 0x0F) << 4;
+   raw[3] = temperature >> 12; raw[4] = temperature >> 4; raw[5] = (temperature & 0x0F) << 4;
+   raw[6] = humidity >> 8; raw[7] = humidity;
+}
+
+
+// Bosch datasheet, 8.1 Compensation formulas in double precision floating point
+static double ReferenceTFine(const Trim& t, int32_t raw)
+{
+   double var1 = (raw / 16384.0 - t.T1 / 1024.0) * t.T2;
+   double var2 = (raw / 131072.0 - t.T1 / 8192.0) * (raw / 131072.0 - t.T1 / 8192.0) * t.T3;
+   return var1 + var2;
+}
+
+
+static double ReferencePressure(const Trim& t, int32_t raw, double t_fine)
+{
+   double var1 = t_fine / 2.0 - 64000.0;
+   double var2 = var1 * var1 * t.P6 / 32768.0;
+   var2 = var2 + var1 * t.P5 * 2.0;
+   var2 = var2 / 4.0 + t.P4 * 65536.0;
+   var1 = (t.P3 * var1 * var1 / 524288.0 + t.P2 * var1) / 524288.0;
+   var1 = (1.0 + var1 / 32768.0) * t.P1;
+   double p = 1048576.0 - raw;
+   p = (p - var2 / 4096.0) * 6250.0 / var1;
+   var1 = t.P9 * p * p / 2147483648.0;
+   var2 = p * t.P8 / 32768.0;
+   return p + (var1 + var2 + t.P7) / 16.0;
+}
+
+
+static double ReferenceHumidity(const Trim& t, int32_t raw, double t_fine)
+{
+   double h = t_fine - 76800.0;
+   h = (raw - (t.H4 * 64.0 + t.H5 / 16384.0 * h)) *
+       (t.H2 / 65536.0 * (1.0 + t.H6 / 67108864.0 * h * (1.0 + t.H3 / 67108864.0 * h)));
+   return h * (1.0 - t.H1 * h / 524288.0);
+}
+
+
+#ifdef BME280_TRIM_CACHE
+uint8_t* hostEepromBlock;
+size_t hostEepromBlockSize;
+
+
+// One power-up of a sensor with the given trim: begin() and a measurement in
+// the operating range, checks the result and the trim bytes read over the bus.
+static bool CheckBegin(const char* name, const Trim& trim, uint32_t expectedTrimBytes)
+{
+   SimulatedBME280 sensor;
+   int32_t rawPressure, rawTemperature, rawHumidity;
+   double temperature, pressure, humidity;
+
+   do
+   {
+      rawPressure = Random(0, (1 << 20) - 1) & ~0x0F;
+      rawTemperature = Random(0, (1 << 20) - 1) & ~0x0F;
+      rawHumidity = Random(0, 0xFFFF);
+      double t_fine = ReferenceTFine(trim, rawTemperature);
+      temperature = t_fine / 5120.0;
+      pressure = ReferencePressure(trim, rawPressure, t_fine);
+      humidity = ReferenceHumidity(trim, rawHumidity, t_fine);
+   } while (temperature < -40.0 || temperature > 85.0 || pressure < 30000.0 || pressure > 110000.0
+      || humidity < 0.0 || humidity > 100.0);
+
+   EncodeTrim(trim, sensor.dig);
+   EncodeRaw(rawPressure, rawTemperature, rawHumidity, sensor.raw);
+   BME280::Data data;
+   if (!sensor.begin() || !sensor.read(data))
+   {
+      printf("trim cache, %s: FAILED, read failed\n", name);
+      return false;
+   }
+   if (fabs(data.temperature / 100.0 - temperature) > TEMPERATURE_LIMIT
+      || fabs(data.pressure / 256.0 - pressure) > PRESSURE_LIMIT
+      || fabs(data.humidity / 1024.0 - humidity) > HUMIDITY_LIMIT)
+   {
+      printf("trim cache, %s: FAILED, wrong trim used\n", name);
+      return false;
+   }
+   if (sensor.trimBytesRead != expectedTrimBytes)
+   {
+      printf("trim cache, %s: FAILED, %lu trim bytes read, expected %lu\n", name,
+         (unsigned long)sensor.trimBytesRead, (unsigned long)expectedTrimBytes);
+      return false;
+   }
+   return true;
+}
+
+
+static bool CheckTrimCache()
+{
+   const uint32_t CHECK = 6, FULL = 32;  // temperature trim, complete trim
+   Trim trim = RandomTrim();
+   Trim otherTrim = RandomTrim();
+   otherTrim.T1 = trim.T1 + 1;
+
+   // Leaves a valid cache behind
+   if (!CheckBegin("first start", trim, hostEepromBlock ? CHECK + FULL : FULL))
+   {
+      return false;
+   }
+   if (!CheckBegin("hit", trim, CHECK))
+   {
+      return false;
+   }
+
+   memset(hostEepromBlock, 0xFF, hostEepromBlockSize);
+   if (!CheckBegin("erased", trim, FULL) || !CheckBegin("hit after erased", trim, CHECK))
+   {
+      return false;
+   }
+
+   // Pressure trim, only the CRC can tell
+   hostEepromBlock[1 + 10] ^= 0x01;
+   if (!CheckBegin("corrupted", trim, FULL) || !CheckBegin("hit after corrupted", trim, CHECK))
+   {
+      return false;
+   }
+
+   if (!CheckBegin("swapped sensor", otherTrim, CHECK + FULL)
+      || !CheckBegin("hit after swapped sensor", otherTrim, CHECK))
+   {
+      return false;
+   }
+   return true;
+}
+#endif
+
+
+int main(int argc, char* argv[])
+{
+   long iterations = (argc > 1) ? atol(argv[1]) : 4000000;
+   long compared = 0;
+   double maxTemperature = 0, maxPressure = 0, maxHumidity = 0;
+   SimulatedBME280 sensor;
+
+   if (!CheckMeasureTimeout())
+   {
+      return 1;
+   }
+#ifdef BME280_TRIM_CACHE
+   if (!CheckTrimCache())
+   {
+      return 1;
+   }
+#endif
+
+   srand(1);
+   for (long i = 0; i < iterations; ++i)
+   {
+      Trim trim = RandomTrim();
+      int32_t rawPressure = Random(0, (1 << 20) - 1) & ~0x0F;
+      int32_t rawTemperature = Random(0, (1 << 20) - 1) & ~0x0F;
+      int32_t rawHumidity = Random(0, 0xFFFF);
+
+      double t_fine = ReferenceTFine(trim, rawTemperature);
+      double temperature = t_fine / 5120.0;
+      double pressure = ReferencePressure(trim, rawPressure, t_fine);
+      double humidity = ReferenceHumidity(trim, rawHumidity, t_fine);
+      if (temperature < -40.0 || temperature > 85.0 || pressure < 30000.0 || pressure > 110000.0
+         || humidity < 0.0 || humidity > 100.0)
+      {
+         continue;
+      }
+
+      EncodeTrim(trim, sensor.dig);
+      EncodeRaw(rawPressure, rawTemperature, rawHumidity, sensor.raw);
+      BME280::Data data;
+      if (!sensor.begin() || !sensor.read(data))
+      {
+         printf("read failed\n");
+         return 1;
+      }
+
+      maxTemperature = fmax(maxTemperature, fabs(data.temperature / 100.0 - temperature));
+      maxPressure = fmax(maxPressure, fabs(data.pressure / 256.0 - pressure));
+      maxHumidity = fmax(maxHumidity, fabs(data.humidity / 1024.0 - humidity));
+      ++compared;
+   }
+
+   bool passed = (compared > 0) && (maxTemperature <= TEMPERATURE_LIMIT)
+      && (maxPressure <= PRESSURE_LIMIT) && (maxHumidity <= HUMIDITY_LIMIT);
+   printf("%s, %ld samples, max. deviation %.4f degC (%.2f), %.3f Pa (%.1f), %.4f %%RH (%.2f)\n",
+      passed ? "passed" : "FAILED", compared, maxTemperature, TEMPERATURE_LIMIT,
+      maxPressure, PRESSURE_LIMIT, maxHumidity, HUMIDITY_LIMIT);
+   return passed ? 0 : 1;
+}
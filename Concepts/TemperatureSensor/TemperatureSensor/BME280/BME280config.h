@@ -0,0 +1,31 @@
+/*
+
+BME280config.h
+
+Build options of the BME280 library, kept with the library so it does not
+depend on the headers of the application using it. Either edit them here or
+define BME280_CONFIG_EXTERNAL and pass the options on the compiler command
+line instead (e.g. -DBME280_CONFIG_EXTERNAL -DBME280_FIXED_POINT).
+
+ */
+
+#ifndef TG_BME_280_CONFIG_H
+#define TG_BME_280_CONFIG_H
+
+#ifndef BME280_CONFIG_EXTERNAL
+
+/// Integer compensation only, no float API (temp(), pres(), hum(),
+/// read(float&, ...)).
+#define BME280_FIXED_POINT
+
+/// Bosch 64-bit pressure formula (1/256 Pa) instead of the 32-bit one
+/// (1 Pa).
+//#define BME280_PRESSURE_64BIT
+
+/// Keep the trim in EEPROM (AVR only), begin() then only reads chip ID
+/// and temperature trim to validate it.
+#define BME280_TRIM_CACHE
+
+#endif // BME280_CONFIG_EXTERNAL
+
+#endif // TG_BME_280_CONFIG_H
@@ -0,0 +1,34 @@
+/*
+
+eeprom.h
+
+Host stand-in for avr-libc's EEPROM access, the EEMEM variables are plain
+RAM. The last block written is recorded so a test can erase or corrupt it.
+
+ */
+
+#ifndef HOST_STUB_AVR_EEPROM_H
+#define HOST_STUB_AVR_EEPROM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define EEMEM
+
+extern uint8_t* hostEepromBlock;    ///< Defined by the test
+extern size_t hostEepromBlockSize;
+
+static inline void eeprom_read_block(void* dst, const void* src, size_t n)
+{
+   memcpy(dst, src, n);
+}
+
+static inline void eeprom_update_block(const void* src, void* dst, size_t n)
+{
+   memcpy(dst, src, n);
+   hostEepromBlock = (uint8_t*)dst;
+   hostEepromBlockSize = n;
+}
+
+#endif // HOST_STUB_AVR_EEPROM_H
@@ -0,0 +1,26 @@
+/*
+
+crc16.h
+
+Host stand-in for avr-libc's CRC helpers, same results as the AVR
+implementation.
+
+ */
+
+#ifndef HOST_STUB_UTIL_CRC16_H
+#define HOST_STUB_UTIL_CRC16_H
+
+#include <stdint.h>
+
+/// CRC-8 (polynomial x^8 + x^2 + x + 1), MSB first
+static inline uint8_t _crc8_ccitt_update(uint8_t crc, uint8_t data)
+{
+   crc ^= data;
+   for (uint8_t i = 0; i < 8; ++i)
+   {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+   }
+   return crc;
+}
+
+#endif // HOST_STUB_UTIL_CRC16_H
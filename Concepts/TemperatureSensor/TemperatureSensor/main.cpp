@@ -6,6 +6,7 @@
 #include "config.h"
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/sleep.h>
 #include <util/delay.h>
 #include <stdlib.h>
 #include "BME280/BME280I2C.h"			// Original source: https://www.github.com/finitespace/BME280
@@ -24,6 +25,7 @@
 #define PACKET_LENGTH_BYTES		(PACKET_LENGTH_BITS / BITS_PER_BYTE)
 #define PACKET_COUNT			15
 #define TX_IN_PROGRESS			(TCCR0B & 0x7)
+#define DELAY_TICK_US			8		// Timer1 @ Clk/64
 
 
 BME280I2C::Settings settings(
@@ -44,6 +46,7 @@ volatile uint8_t txBuffer[PACKET_LENGTH_BYTES];
 volatile uint8_t currentByte;
 volatile uint8_t currentBit;
 volatile uint8_t cmdReadEnvironmentData;
+volatile uint8_t delayElapsed;
 
 
 ISR(TIMER0_OVF_vect)
@@ -124,6 +127,44 @@ ISR(TIMER3_OVF_vect)
 }
 
 
+ISR(TIMER1_COMPA_vect)
+{
+	// One-shot
+	TCCR1B = 0;
+	delayElapsed = 1;
+}
+
+
+void sleepUs(const uint32_t& us)
+{
+	// Timer1 is only powered for the duration of the delay, Clk/64 => max. 524 ms
+	PRR0 &= ~(1 << PRTIM1);
+	delayElapsed = 0;
+	TCNT1 = 0;
+	OCR1A = (us + DELAY_TICK_US - 1) / DELAY_TICK_US;
+	TIFR1 = (1 << OCF1A);
+	TIMSK1 = (1 << OCIE1A);
+	TCCR1A = 0;
+	TCCR1B = (1 << WGM12) | (3 << CS10); // CTC, clk/64
+	
+	// Timer0 (TX) and Timer3 interrupts wake up as well, check the flag with interrupts disabled before going back to sleep
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	cli();
+	while (!delayElapsed)
+	{
+		sleep_enable();
+		sei();
+		sleep_cpu();
+		sleep_disable();
+		cli();
+	}
+	sei();
+	
+	TIMSK1 = 0;
+	PRR0 |= (1 << PRTIM1);
+}
+
+
 int16_t centigradeToFahrenheit(const int16_t& in)
 {
 	return (in * 18 / 10) + 320;
@@ -136,10 +177,11 @@ uint16_t fahrenheitToRaw(const int16_t& in)
 }
 
 
-void assemblePacket(const uint8_t& id, const uint8_t& batteryLow, const uint8_t& test, const uint8_t& channel, const float& temperature, const float& humidity)
+void assemblePacket(const uint8_t& id, const uint8_t& batteryLow, const uint8_t& test, const uint8_t& channel, const BME280::Data& data)
 {
-	uint8_t intHumidity = (uint8_t)round(humidity);
-	int16_t intTemperature = (int16_t)round(temperature * 10.0);
+	// 0.01 °C => 0.1 °C, %RH Q22.10 => %RH, both rounded
+	uint8_t intHumidity = (uint8_t)((data.humidity + 512) >> 10);
+	int16_t intTemperature = (int16_t)((data.temperature + (data.temperature < 0 ? -5 : 5)) / 10);
 	
 #ifdef ENABLE_DEBUG
 	debug.sendText("\tID ");
@@ -174,9 +216,7 @@ int main(void)
 	uint8_t batteryLow = 0;
 	uint8_t testButtonPressed = 0;
 	uint8_t channel = 2;
-	float temperature = NAN;
-	float humidity = NAN;
-	float pressure = NAN;
+	BME280::Data data;
 	
 	cmdReadEnvironmentData = 1;
 	
@@ -227,12 +267,21 @@ int main(void)
 #ifdef ENABLE_DEBUG
 			debug.sendText("Starting measurement\n");
 #endif			
-			bme.read(pressure, temperature, humidity); // Returns hPa and Celsius
-			testButtonPressed = SW0_PRESSED;
-			
-			assemblePacket(id, batteryLow, testButtonPressed, channel, temperature, humidity);
-			
-			packetCount = PACKET_COUNT;
+			// Trigger, sleep until the conversion is done, then fetch all results in one burst
+			bool valid = bme.startMeasurement();
+			if (valid)
+			{
+				sleepUs(bme.measurementTime());
+				valid = bme.readMeasurement(data);
+			}
+			if (valid)
+			{
+				testButtonPressed = SW0_PRESSED;
+				
+				assemblePacket(id, batteryLow, testButtonPressed, channel, data);
+				
+				packetCount = PACKET_COUNT;
+			}
 			cmdReadEnvironmentData = 0;
 			_delay_ms(100);
 		}
@@ -41,6 +41,7 @@ extern "C"
 #define AHTX0_CMD_SOFTRESET			0xBA	// Soft reset command
 #define AHTX0_STATUS_BUSY			0x80	// Status bit for busy
 #define AHTX0_STATUS_CALIBRATED		0x08	// Status bit for calibrated
+#define AHTX0_MAX_BUSY_POLLS		20		// Give up after 20 x 10 ms
 
 
 bool AHTX0::begin(const uint8_t i2c_address)
@@ -59,21 +60,24 @@ bool AHTX0::begin(const uint8_t i2c_address)
 	}
 	_delay_ms(20);
 
-	while (getStatus() & AHTX0_STATUS_BUSY)
+	uint8_t status = getStatus();
+	if (!waitWhileBusy(status))
 	{
-		_delay_ms(10);
+		return false;
 	}
 
+	// Calibration command and first status poll in one transaction (repeated START instead of STOP + START)
+	status = 0xFF;
 	cmd[0] = AHTX0_CMD_CALIBRATE;
 	cmd[1] = 0x08;
 	cmd[2] = 0x00;
-	TWI_MasterWrite(mAddress, cmd, 3, TWIM_SEND_STOP); // may not 'succeed' on newer AHT20s
+	TWI_MasterWriteRead(mAddress, cmd, 3, &status, 1, TWIM_SEND_STOP); // may not 'succeed' on newer AHT20s
 
-	while (getStatus() & AHTX0_STATUS_BUSY)
+	if (!waitWhileBusy(status))
 	{
-		_delay_ms(10);
+		return false;
 	}
-	if (!(getStatus() & AHTX0_STATUS_CALIBRATED))
+	if (!(status & AHTX0_STATUS_CALIBRATED))
 	{
 		return false;
 	}
@@ -90,6 +94,23 @@ uint8_t AHTX0::getStatus()
 }
 
 
+bool AHTX0::waitWhileBusy(uint8_t &status)
+{
+	// A failed read returns 0xFF (busy), so a dead bus ends up here as well
+	uint8_t polls = AHTX0_MAX_BUSY_POLLS;
+	while (status & AHTX0_STATUS_BUSY)
+	{
+		if (--polls == 0)
+		{
+			return false;
+		}
+		_delay_ms(10);
+		status = getStatus();
+	}
+	return true;
+}
+
+
 bool AHTX0::isBusy()
 {
 	return (getStatus() & AHTX0_STATUS_BUSY) == AHTX0_STATUS_BUSY;
@@ -113,16 +134,20 @@ void AHTX0::readData(uint8_t *pData)
 }
 
 
-void AHTX0::readData(uint32_t &humidity, int32_t &temperature)
+bool AHTX0::readData(uint32_t &humidity, int32_t &temperature)
 {
 	uint8_t data[6];
-	TWI_MasterRead(mAddress, data, 6, TWIM_SEND_STOP);
+	if (TWI_MasterRead(mAddress, data, 6, TWIM_SEND_STOP) != 6)
+	{
+		return false;
+	}
 	
 	uint32_t srh = ((uint32_t)data[1] * 0x1000) + ((uint32_t)data[2] * 0x10) + (data[3] / 0x10);
 	humidity = (uint32_t)srh * (uint32_t)100 / (uint32_t)0x100000;
 	
 	uint32_t st = ((uint32_t)(data[3] & 0x0F) * 0x10000) + ((uint32_t)data[4] * 0x100) + data[5];
 	temperature = (int32_t)st * (int32_t)2000 / (int32_t)0x100000 - (int32_t)500;
+	return true;
 }
 
 
@@ -153,9 +178,10 @@ bool AHTX0::read(float &humidity, float &temperature)
 	{
 		return false;
 	}
-	while (isBusy())
+	uint8_t status = getStatus();
+	if (!waitWhileBusy(status))
 	{
-		_delay_ms(10);
+		return false;
 	}
 	readData(humidity, temperature);
 	return true;
@@ -41,12 +41,13 @@ public:
 	bool begin(const uint8_t i2c_address = AHTX0_I2CADDR_DEFAULT);
 	bool read(float &humidity, float &temperature);
 	void readData(float &humidity, float &temperature);
-	void readData(uint32_t &humidity, int32_t &temperature);
+	bool readData(uint32_t &humidity, int32_t &temperature);
 	void readData(uint8_t *pData);
 	bool triggerRead();
 	bool isBusy();
 	
 private:
 	uint8_t getStatus();
+	bool waitWhileBusy(uint8_t &status);
 	uint8_t mAddress;
 };
@@ -6,19 +6,54 @@
  */ 
 
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #include "Debug.h"
 #include <stdlib.h>
 
+#ifdef ENABLE_DEBUG
+
+static uint8_t txBuffer[TX_BUFFER_SIZE];
+static volatile uint8_t txHead = 0;
+static volatile uint8_t txTail = 0;
+static volatile bool txPending = false;
+
+
+ISR(USART0_DRE_vect)
+{
+	uint8_t tail = txTail;
+	
+	if (tail != txHead)
+	{
+		// Transmit complete flag needs to be explicitly cleared, see isBusy()
+		USART0.STATUS = USART_TXCIF_bm;
+		USART0.TXDATAL = txBuffer[tail];
+		txTail = (tail + 1) & (TX_BUFFER_SIZE - 1);
+	}
+	else
+	{
+		// Buffer empty - disable interrupt until next sendByte()
+		USART0.CTRLA = 0;
+	}
+}
+
 
 SerialDebugging::SerialDebugging()
+	: eventSequence(0)
 {}
 
 
 void SerialDebugging::sendByte(const uint8_t character)
 {
-	// Wait for data register empty flag
-	while ((USART0.STATUS & USART_DREIF_bm) == 0);
-	USART0.TXDATAL = character;
+	uint8_t head = txHead;
+	uint8_t next = (head + 1) & (TX_BUFFER_SIZE - 1);
+	
+	// Buffer full: wait for the interrupt to make room (requires global interrupts enabled)
+	while (next == txTail);
+	
+	txBuffer[head] = character;
+	txHead = next;
+	txPending = true;
+	USART0.CTRLA = USART_DREIE_bm;
 }
 
 
@@ -29,12 +64,6 @@ void SerialDebugging::sendText(const char* text)
 		sendByte(*text);
 		text++;
 	}
-	
-	// Wait for transmit complete flag (in order to make sure transmission is complete before entering a sleep)
-	// Is set when the entire frame in the Transmit Shift register has been shifted out, and there is no new data in the transmit buffer.
-	// Needs to be explicitly cleared.
-	while ((USART0.STATUS & USART_TXCIF_bm) == 0);
-	USART0.STATUS |= USART_TXCIF_bm;
 }
 
 
@@ -54,6 +83,85 @@ void SerialDebugging::sendHexValue(const uint32_t value)
 }
 
 
+void SerialDebugging::sendVarint(const int32_t value)
+{
+	// Zigzag encoding keeps small negative values short
+	uint32_t raw = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+	
+	while (raw > 0x7F)
+	{
+		sendByte((raw & 0x7F) | 0x80);
+		raw >>= 7;
+	}
+	sendByte(raw);
+}
+
+
+void SerialDebugging::sendEvent(const uint8_t event)
+{
+	sendByte(TRACE_EVENT_MARKER | event);
+	sendByte(eventSequence++);
+}
+
+
+void SerialDebugging::sendEvent(const uint8_t event, const int32_t a)
+{
+	sendEvent(event);
+	sendVarint(a);
+}
+
+
+void SerialDebugging::sendEvent(const uint8_t event, const int32_t a, const int32_t b)
+{
+	sendEvent(event, a);
+	sendVarint(b);
+}
+
+
+void SerialDebugging::sendEvent(const uint8_t event, const int32_t a, const int32_t b, const int32_t c)
+{
+	sendEvent(event, a, b);
+	sendVarint(c);
+}
+
+
+void SerialDebugging::sendEvent(const uint8_t event, const int32_t a, const int32_t b, const int32_t c, const int32_t d)
+{
+	sendEvent(event, a, b, c);
+	sendVarint(d);
+}
+
+
+void SerialDebugging::sendEvent(const uint8_t event, const int32_t a, const int32_t b, const int32_t c, const int32_t d, const int32_t e)
+{
+	sendEvent(event, a, b, c, d);
+	sendVarint(e);
+}
+
+
+bool SerialDebugging::isBusy()
+{
+	if (!txPending)
+	{
+		return false;
+	}
+	// Transmit complete flag is set when the entire frame in the Transmit Shift register
+	// has been shifted out, and there is no new data in the transmit buffer.
+	if (txTail == txHead && (USART0.STATUS & USART_TXCIF_bm) != 0)
+	{
+		txPending = false;
+		return false;
+	}
+	return true;
+}
+
+
+void SerialDebugging::flush()
+{
+	while (isBusy());
+}
+
+
 void SerialDebugging::begin()
 {
 	// Port mapping verified for ATtiny816
@@ -67,3 +175,5 @@ void SerialDebugging::begin()
 	USART0.CTRLC = USART_CHSIZE_8BIT_gc;
 	USART0.CTRLB = USART_RXEN_bm | USART_TXEN_bm | (USE_CLK2X ? USART_RXMODE_CLK2X_gc : USART_RXMODE_NORMAL_gc);
 }
+
+#endif
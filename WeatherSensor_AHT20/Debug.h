@@ -8,6 +8,7 @@
 #pragma once
 
 #include "deviceconfig.h"
+#include "TraceEvents.h"
 
 #define BAUD_RATE						115200UL
 #define USE_CLK2X						1
@@ -18,16 +19,26 @@
 #  error "Achieved baud rate invalid!"
 #endif
 
+#define TX_BUFFER_SIZE					64				/* Must be a power of 2 */
+
+#if (TX_BUFFER_SIZE & (TX_BUFFER_SIZE - 1)) != 0 || TX_BUFFER_SIZE > 256
+#  error "TX_BUFFER_SIZE must be a power of 2 <= 256!"
+#endif
+
 #ifdef ENABLE_DEBUG
   #define DEBUG_TEXT					debug.sendText
   #define DEBUG_BYTE					debug.sendByte
   #define DEBUG_VALUE					debug.sendValue
   #define DEBUG_HEX						debug.sendHexValue
+  #define DEBUG_EVENT					debug.sendEvent
+  #define DEBUG_FLUSH()					debug.flush()
 #else
   #define DEBUG_TEXT					(void)
   #define DEBUG_BYTE					(void)
   #define DEBUG_VALUE					(void)
   #define DEBUG_HEX						(void)
+  #define DEBUG_EVENT(...)				do {} while (0)		/* arguments are not evaluated */
+  #define DEBUG_FLUSH()
 #endif
 
 class SerialDebugging
@@ -40,4 +51,27 @@ public:
 	void sendText(const char* text);
 	void sendValue(const int16_t value);
 	void sendHexValue(const uint32_t value);
+	
+	// Binary trace event (see TraceEvents.h), decoded on the host by TraceDecoder
+	void sendEvent(const uint8_t event);
+	void sendEvent(const uint8_t event, const int32_t a);
+	void sendEvent(const uint8_t event, const int32_t a, const int32_t b);
+	void sendEvent(const uint8_t event, const int32_t a, const int32_t b, const int32_t c);
+	void sendEvent(const uint8_t event, const int32_t a, const int32_t b, const int32_t c, const int32_t d);
+	void sendEvent(const uint8_t event, const int32_t a, const int32_t b, const int32_t c, const int32_t d, const int32_t e);
+	
+	// Transmission runs in the background (USART0 DRE interrupt).
+	// Data still in the buffer or shift register is lost when the USART clock stops,
+	// so flush() before changing the CPU clock and don't enter STANDBY/POWERDOWN while isBusy().
+	void flush();
+	bool isBusy();
+	
+private:
+	void sendVarint(const int32_t value);
+	
+	uint8_t eventSequence;
 };
+
+#ifdef ENABLE_DEBUG
+extern SerialDebugging debug;
+#endif
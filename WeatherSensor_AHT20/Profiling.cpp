@@ -0,0 +1,92 @@
+/*
+ * Profiling.cpp
+ *
+ * Active CPU cycles per loop() pass, accumulated per OperationStates entry.
+ */ 
+
+#include <avr/io.h>
+#include "Profiling.h"
+#include "Debug.h"
+#include <string.h>
+
+#ifdef ENABLE_PROFILING
+
+StateProfiler::StateProfiler()
+	: currentState(0), dumpCountdown(PROFILE_DUMP_INTERVAL)
+{
+	memset(stats, 0, sizeof(stats));
+}
+
+
+void StateProfiler::begin()
+{
+	TCA0.SINGLE.PER = 0xFFFF;
+	TCA0.SINGLE.CTRLA = TCA_SINGLE_CLKSEL_DIV1_gc | TCA_SINGLE_ENABLE_bm;
+}
+
+
+void StateProfiler::enter(const uint8_t state)
+{
+	currentState = state;
+	TCA0.SINGLE.INTFLAGS = TCA_SINGLE_OVF_bm;
+	TCA0.SINGLE.CNT = 0;
+}
+
+
+void StateProfiler::leave()
+{
+	uint16_t cycles = TCA0.SINGLE.CNT;
+	
+	if (TCA0.SINGLE.INTFLAGS & TCA_SINGLE_OVF_bm)
+	{
+		cycles = 0xFFFF;
+	}
+	if (currentState >= PROFILE_MAX_STATES)
+	{
+		return;
+	}
+	
+	Statistics& s = stats[currentState];
+	if (s.count == 0 || cycles < s.min)
+	{
+		s.min = cycles;
+	}
+	if (cycles > s.max)
+	{
+		s.max = cycles;
+	}
+	s.sum += cycles;
+	++s.count;
+	
+	// Restart statistics before the counters overflow
+	if (s.count == 0xFFFF || s.sum > 0xFFFF0000UL)
+	{
+		dump();
+	}
+}
+
+
+void StateProfiler::dump()
+{
+	for (uint8_t state = 0; state < PROFILE_MAX_STATES; ++state)
+	{
+		const Statistics& s = stats[state];
+		if (s.count > 0)
+		{
+			DEBUG_EVENT(TRACE_PROFILE, state, s.count, s.min, s.sum / s.count, s.max);
+		}
+	}
+	memset(stats, 0, sizeof(stats));
+}
+
+
+void StateProfiler::dumpPeriodic()
+{
+	if (--dumpCountdown == 0)
+	{
+		dumpCountdown = PROFILE_DUMP_INTERVAL;
+		dump();
+	}
+}
+
+#endif
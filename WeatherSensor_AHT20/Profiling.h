@@ -0,0 +1,62 @@
+/*
+ * Profiling.h
+ *
+ * Active CPU cycles per loop() pass, accumulated per OperationStates entry.
+ */ 
+
+#pragma once
+
+#include "deviceconfig.h"
+#include <stdint.h>
+
+#define PROFILE_MAX_STATES				8				/* 10 bytes RAM per state (Statistics), 82 bytes per StateProfiler */
+#define PROFILE_DUMP_INTERVAL			15				/* Measurement cycles between periodic dumps */
+
+#ifdef ENABLE_PROFILING
+  #ifndef ENABLE_DEBUG
+    #error "ENABLE_PROFILING requires ENABLE_DEBUG!"
+  #endif
+  #define PROFILE_INIT()				profiler.begin()
+  #define PROFILE_ENTER(_state_)		profiler.enter(_state_)
+  #define PROFILE_LEAVE()				profiler.leave()
+  #define PROFILE_DUMP()				profiler.dump()
+  #define PROFILE_DUMP_PERIODIC()		profiler.dumpPeriodic()
+#else
+  #define PROFILE_INIT()
+  #define PROFILE_ENTER(_state_)
+  #define PROFILE_LEAVE()
+  #define PROFILE_DUMP()
+  #define PROFILE_DUMP_PERIODIC()
+#endif
+
+// TCA0 counts CLK_PER, i.e. CPU cycles at whatever clock is currently selected.
+// It stops in STANDBY/POWERDOWN, so sleep time is excluded while IDLE sleep (TWI waits) is included.
+// A single pass is limited to 65535 cycles (saturates).
+class StateProfiler
+{
+public:
+	StateProfiler();
+	
+	void begin();
+	void enter(const uint8_t state);
+	void leave();
+	void dump();
+	void dumpPeriodic();
+	
+private:
+	struct Statistics
+	{
+		uint16_t min;
+		uint16_t max;
+		uint32_t sum;
+		uint16_t count;
+	};
+	
+	Statistics stats[PROFILE_MAX_STATES];
+	uint8_t currentState;
+	uint8_t dumpCountdown;
+};
+
+#ifdef ENABLE_PROFILING
+extern StateProfiler profiler;
+#endif
@@ -0,0 +1,182 @@
+/*
+ * TraceDecoder.cpp
+ *
+ * Host-side decoder for the binary trace (see TraceEvents.h).
+ * Build: g++ -O2 -o TraceDecoder TraceDecoder.cpp
+ * Usage: TraceDecoder [/dev/ttyUSB0 | capture.bin]	(reads stdin if omitted)
+ */ 
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "../TraceEvents.h"
+
+#define TRACE_EVENT_FORMAT(_name_, _format_)	_format_,
+#define TRACE_EVENT_NAME(_name_, _format_)		#_name_,
+
+static const char* const eventFormats[TRACE_EVENT_COUNT] = { TRACE_EVENT_LIST(TRACE_EVENT_FORMAT) };
+static const char* const eventNames[TRACE_EVENT_COUNT] = { TRACE_EVENT_LIST(TRACE_EVENT_NAME) };
+
+
+static int openInput(const char* path)
+{
+	int fd = open(path, O_RDONLY | O_NOCTTY);
+	if (fd < 0)
+	{
+		perror(path);
+		return -1;
+	}
+	if (isatty(fd))
+	{
+		// Firmware: 115200 8N1 (Debug.h)
+		struct termios tio;
+		tcgetattr(fd, &tio);
+		cfmakeraw(&tio);
+		cfsetispeed(&tio, B115200);
+		cfsetospeed(&tio, B115200);
+		tio.c_cc[VMIN] = 1;
+		tio.c_cc[VTIME] = 0;
+		tcsetattr(fd, TCSANOW, &tio);
+	}
+	return fd;
+}
+
+
+static int readByte(int fd)
+{
+	uint8_t c;
+	return (read(fd, &c, 1) == 1) ? c : -1;
+}
+
+
+// Zigzag encoded, 7 bits per byte, LSB first, bit 7 = more bytes follow
+static bool readVarint(int fd, int32_t& value)
+{
+	uint32_t raw = 0;
+	for (uint8_t shift = 0; shift < 35; shift += 7)
+	{
+		int c = readByte(fd);
+		if (c < 0)
+		{
+			return false;
+		}
+		raw |= (uint32_t)(c & 0x7F) << shift;
+		if ((c & 0x80) == 0)
+		{
+			value = (int32_t)(raw >> 1) ^ -(int32_t)(raw & 1);
+			return true;
+		}
+	}
+	return false;
+}
+
+
+static uint8_t countArguments(const char* format)
+{
+	uint8_t count = 0;
+	for (const char* p = format; (p = strstr(p, "%d")) != nullptr; p += 2)
+	{
+		++count;
+	}
+	return count;
+}
+
+
+static void printEvent(const char* format, const int32_t* args)
+{
+	for (const char* p = format; *p; ++p)
+	{
+		if (p[0] == '%' && p[1] == 'd')
+		{
+			printf("%d", *args++);
+			++p;
+		}
+		else
+		{
+			putchar(*p);
+		}
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	int fd = (argc > 1) ? openInput(argv[1]) : STDIN_FILENO;
+	if (fd < 0)
+	{
+		return 1;
+	}
+	
+	bool lineStart = true;
+	int expectedSequence = -1;
+	int c;
+	
+	while ((c = readByte(fd)) >= 0)
+	{
+		if (c < TRACE_EVENT_MARKER)
+		{
+			// Plain text
+			putchar(c);
+			lineStart = (c == '\n');
+			fflush(stdout);
+			continue;
+		}
+		
+		if (!lineStart)
+		{
+			putchar('\n');
+		}
+		lineStart = true;
+		
+		uint8_t id = c & ~TRACE_EVENT_MARKER;
+		if (id >= TRACE_EVENT_COUNT)
+		{
+			printf("?? unknown event 0x%02X - decoder out of date?\n", id);
+			expectedSequence = -1;
+			continue;
+		}
+		
+		int sequence = readByte(fd);
+		if (sequence < 0)
+		{
+			break;
+		}
+		if (id == TRACE_BOOT)
+		{
+			expectedSequence = sequence;
+		}
+		if (expectedSequence >= 0 && sequence != expectedSequence)
+		{
+			printf("!! %d event(s) lost\n", (uint8_t)(sequence - expectedSequence));
+		}
+		expectedSequence = (sequence + 1) & 0xFF;
+		
+		int32_t args[8];
+		uint8_t argCount = countArguments(eventFormats[id]);
+		bool complete = (argCount <= 8);
+		for (uint8_t i = 0; complete && i < argCount; ++i)
+		{
+			complete = readVarint(fd, args[i]);
+		}
+		if (!complete)
+		{
+			printf("?? truncated %s\n", eventNames[id]);
+			continue;
+		}
+		
+		printf("[%3d] ", sequence);
+		printEvent(eventFormats[id], args);
+		putchar('\n');
+		fflush(stdout);
+	}
+	
+	if (fd != STDIN_FILENO)
+	{
+		close(fd);
+	}
+	return 0;
+}
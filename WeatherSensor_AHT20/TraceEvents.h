@@ -0,0 +1,26 @@
+/*
+ * TraceEvents.h
+ *
+ * Binary trace events, shared by the firmware (DEBUG_EVENT) and the host-side TraceDecoder.
+ */ 
+
+#pragma once
+
+/* X(name, format): one entry per DEBUG_EVENT call site, the id is the position in the list (append only!).
+ * On the wire: [TRACE_EVENT_MARKER | id] [sequence] [zigzag varint for each %d in format].
+ * Bytes < TRACE_EVENT_MARKER outside of an event are plain text (DEBUG_TEXT etc.).
+ */
+#define TRACE_EVENT_LIST(X) \
+	X(TRACE_BOOT,					"boot") \
+	X(TRACE_SENSOR_DATA,			"#%d t%d h%d") \
+	X(TRACE_TWI_ERRORS,				"E%d/%d/%d") \
+	X(TRACE_PROFILE,				"state %d: n=%d min=%d avg=%d max=%d cycles")
+
+#define TRACE_EVENT_MARKER				0x80
+
+#define TRACE_EVENT_ENUM(_name_, _format_)	_name_,
+
+enum TraceEvents {
+	TRACE_EVENT_LIST(TRACE_EVENT_ENUM)
+	TRACE_EVENT_COUNT
+};
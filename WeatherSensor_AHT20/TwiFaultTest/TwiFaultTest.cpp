@@ -0,0 +1,466 @@
+/*
+ * TwiFaultTest.cpp
+ *
+ * Host-side fault injection test of the TWI master driver (twi.c).
+ * TWI0, the bus pins on PORTB and the RTC are simulated (see avr/io.h in this directory),
+ * a scripted slave answers on the bus and can NACK, raise a bus error, lose arbitration
+ * or hold SDA low.
+ * Build: g++ -std=gnu++17 -O2 -Wno-narrowing -I. -o TwiFaultTest TwiFaultTest.cpp
+ *        (twi.c is included and compiled as C++ against the register proxies)
+ * Usage: TwiFaultTest	(exit code 0 if all scenarios pass)
+ *
+ * Every fault has to end the transaction with the matching result and error counter, a stuck
+ * bus right after TWI_TIMEOUT_TICKS (woken by the RTC compare match or spinning, not by the PIT)
+ * followed by a bus recovery, and the next transaction has to succeed again. The RTC models the
+ * CMP synchronisation (CMPBUSY), a compare value passed during it is missed.
+ */ 
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+#include "../twi.c"
+
+
+#define SLAVE_ADDRESS					0x38
+#define PIT_PERIOD_TICKS				4096	/* RTC ticks until the PIT wakes up the CPU anyway */
+#define RTC_SYNC_TICKS					2		/* RTC cycles until a written CMP value is in effect (CMPBUSY) */
+#define READS_PER_TICK					4		/* RTC.CNT reads per RTC tick while the CPU spins */
+
+enum Fault
+{
+	FAULT_NONE,
+	FAULT_ADDRESS_NACK,			/* Nobody acknowledges the address */
+	FAULT_DATA_NACK,			/* The slave NACKs the second data byte */
+	FAULT_BUS_ERROR,			/* Illegal bus condition during the address */
+	FAULT_ARBITRATION_LOST,		/* Another master wins the address phase */
+	FAULT_STUCK,				/* The slave holds SDA low, the START never completes */
+};
+
+PORT_t PORTA, PORTB, PORTC;
+TWI_t TWI0;
+RTC_t RTC;
+SLPCTRL_t SLPCTRL;
+volatile uint8_t simInterruptsEnabled;
+
+static struct
+{
+	Fault fault;
+	uint8_t faultCount;			/* Number of START conditions the fault applies to */
+	uint8_t stuckClocks;		/* SCL pulses until a stuck slave releases SDA */
+	bool sdaHeld;
+	uint8_t written[16];
+	uint8_t writtenCount;
+	uint8_t readIndex;
+	uint8_t sclPulses;			/* Recovery clocks seen on the pins */
+	uint8_t pinStops;			/* STOP conditions generated on the pins */
+	uint8_t stops;				/* STOP conditions issued by the TWI master */
+	uint8_t starts;				/* START and repeated START conditions issued by the TWI master */
+	uint16_t pitWakeups;		/* Sleeps no other interrupt has woken up */
+	uint16_t cmpWriteTime;		/* RTC.CNT when RTC.CMP was written */
+	uint16_t cmpPrevious;		/* RTC.CMP value in effect before */
+	uint16_t cntReads;
+} bus;
+
+static const uint8_t slaveData[8] = { 0x1C, 0x6B, 0x2A, 0x95, 0xC4, 0x71, 0x3E, 0x00 };
+
+
+static bool twiInterruptPending()
+{
+	uint8_t control = TWI0.MCTRLA.value;
+	uint8_t status = TWI0.MSTATUS.value;
+	return (control & TWI_ENABLE_bm)
+		&& (((control & TWI_WIEN_bm) && (status & TWI_WIF_bm)) || ((control & TWI_RIEN_bm) && (status & TWI_RIF_bm)));
+}
+
+
+void simService(void)
+{
+	while (simInterruptsEnabled && twiInterruptPending())
+	{
+		simInterruptsEnabled = 0;
+		TWI0_TWIM_vect();
+		simInterruptsEnabled = 1;
+	}
+}
+
+
+/* A new CMP value only takes effect RTC_SYNC_TICKS after writing it. If the counter has
+ * passed it by then, the next match is a counter wrap (64 s) away. */
+static bool compareReachable()
+{
+	uint16_t compare = RTC.CMP.value;
+	uint16_t active = bus.cmpWriteTime + ((compare != bus.cmpPrevious) ? RTC_SYNC_TICKS : 0);
+	if ((int16_t)(active - RTC.CNT.value) < 0)
+	{
+		active = RTC.CNT.value;
+	}
+	return (int16_t)(compare - active) > 0;
+}
+
+
+void simSleep(void)
+{
+	if (!simInterruptsEnabled)
+	{
+		/* Nothing could wake up the CPU */
+		bus.pitWakeups = 0xFFFF;
+		return;
+	}
+	if (twiInterruptPending())
+	{
+		simService();
+	}
+	else if ((RTC.INTCTRL.value & RTC_CMP_bm) && compareReachable())
+	{
+		RTC.CNT.value = RTC.CMP.value;
+		RTC.INTFLAGS.value = 0;
+	}
+	else
+	{
+		RTC.CNT.value += PIT_PERIOD_TICKS;
+		bus.pitWakeups++;
+	}
+}
+
+
+static void twiStatus(uint8_t flags, TWI_BUSSTATE_t state)
+{
+	TWI0.MSTATUS.value = (TWI0.MSTATUS.value & (TWI_ARBLOST_bm | TWI_BUSERR_bm)) | flags | state;
+}
+
+
+static void twiStart(uint8_t address)
+{
+	bus.starts++;
+	bus.writtenCount = 0;
+	bus.readIndex = 0;
+
+	Fault fault = (bus.faultCount > 0) ? bus.fault : FAULT_NONE;
+	if (fault != FAULT_NONE && fault != FAULT_DATA_NACK)
+	{
+		bus.faultCount--;
+	}
+
+	switch (fault)
+	{
+	case FAULT_ARBITRATION_LOST:
+		twiStatus(TWI_WIF_bm | TWI_ARBLOST_bm, TWI_BUSSTATE_BUSY_gc);
+		break;
+	case FAULT_BUS_ERROR:
+		twiStatus(TWI_WIF_bm | TWI_BUSERR_bm, TWI_BUSSTATE_IDLE_gc);
+		break;
+	case FAULT_STUCK:
+		bus.sdaHeld = true;
+		twiStatus(0, TWI_BUSSTATE_BUSY_gc);
+		break;
+	default:
+		if ((address >> 1) != SLAVE_ADDRESS || fault == FAULT_ADDRESS_NACK)
+		{
+			twiStatus(TWI_WIF_bm | TWI_RXACK_bm, TWI_BUSSTATE_OWNER_gc);
+		}
+		else if (address & 0x01)
+		{
+			TWI0.MDATA.value = slaveData[bus.readIndex++ & 0x07];
+			twiStatus(TWI_RIF_bm | TWI_CLKHOLD_bm, TWI_BUSSTATE_OWNER_gc);
+		}
+		else
+		{
+			twiStatus(TWI_WIF_bm | TWI_CLKHOLD_bm, TWI_BUSSTATE_OWNER_gc);
+		}
+		break;
+	}
+}
+
+
+void simWrite(simreg8_t* reg, uint8_t value)
+{
+	if (reg == &TWI0.MADDR)
+	{
+		reg->value = value;
+		if (TWI0.MCTRLA.value & TWI_ENABLE_bm)
+		{
+			twiStart(value);
+		}
+	}
+	else if (reg == &TWI0.MDATA)
+	{
+		reg->value = value;
+		bus.written[bus.writtenCount++ & 0x0F] = value;
+		bool nack = (bus.fault == FAULT_DATA_NACK) && (bus.faultCount > 0) && (bus.writtenCount == 2);
+		if (nack)
+		{
+			bus.faultCount--;
+		}
+		twiStatus(TWI_WIF_bm | TWI_CLKHOLD_bm | (nack ? TWI_RXACK_bm : 0), TWI_BUSSTATE_OWNER_gc);
+	}
+	else if (reg == &TWI0.MCTRLB)
+	{
+		reg->value = value & ~TWI_MCMD_gm;
+		switch (value & TWI_MCMD_gm)
+		{
+		case TWI_MCMD_RECVTRANS_gc:
+			TWI0.MDATA.value = slaveData[bus.readIndex++ & 0x07];
+			twiStatus(TWI_RIF_bm | TWI_CLKHOLD_bm, TWI_BUSSTATE_OWNER_gc);
+			break;
+		case TWI_MCMD_STOP_gc:
+			bus.stops++;
+			TWI0.MSTATUS.value &= ~(TWI_RIF_bm | TWI_WIF_bm | TWI_CLKHOLD_bm | TWI_BUSSTATE_gm);
+			TWI0.MSTATUS.value |= TWI_BUSSTATE_IDLE_gc;
+			break;
+		}
+	}
+	else if (reg == &TWI0.MSTATUS)
+	{
+		/* Flags are cleared by writing one, the bus state can be forced */
+		reg->value &= ~(value & ~TWI_BUSSTATE_gm);
+		if (value & TWI_BUSSTATE_gm)
+		{
+			reg->value = (reg->value & ~TWI_BUSSTATE_gm) | (value & TWI_BUSSTATE_gm);
+		}
+	}
+	else if (reg == &PORTB.DIRSET)
+	{
+		PORTB.DIR.value |= value;
+	}
+	else if (reg == &PORTB.DIRCLR)
+	{
+		uint8_t released = PORTB.DIR.value & value;
+		PORTB.DIR.value &= ~value;
+		if (released & SCL_BIT)
+		{
+			bus.sclPulses++;
+			if (bus.sdaHeld && bus.stuckClocks > 0 && --bus.stuckClocks == 0)
+			{
+				bus.sdaHeld = false;
+			}
+		}
+		if ((released & SDA_BIT) && !(PORTB.DIR.value & SCL_BIT) && !bus.sdaHeld)
+		{
+			bus.pinStops++;
+		}
+	}
+	else
+	{
+		reg->value = value;
+	}
+}
+
+
+void simWrite(simreg16_t* reg, uint16_t value)
+{
+	if (reg == &RTC.CMP)
+	{
+		bus.cmpWriteTime = RTC.CNT.value;
+		bus.cmpPrevious = reg->value;
+	}
+	reg->value = value;
+}
+
+
+uint8_t simRead(simreg8_t* reg)
+{
+	if (reg == &PORTB.IN)
+	{
+		uint8_t low = PORTB.DIR.value | (bus.sdaHeld ? SDA_BIT : 0);
+		return (SCL_BIT | SDA_BIT) & ~low;
+	}
+	if (reg == &RTC.STATUS)
+	{
+		bool busy = (uint16_t)(RTC.CNT.value - bus.cmpWriteTime) < RTC_SYNC_TICKS;
+		return busy ? RTC_CMPBUSY_bm : 0;
+	}
+	return reg->value;
+}
+
+
+uint16_t simRead(simreg16_t* reg)
+{
+	if (reg == &RTC.CNT && (++bus.cntReads % READS_PER_TICK) == 0)
+	{
+		reg->value++;
+	}
+	return reg->value;
+}
+
+
+static void simReset(Fault fault, uint8_t faultCount, uint8_t stuckClocks, uint16_t time)
+{
+	memset(&bus, 0, sizeof(bus));
+	memset((void*)&TWI0, 0, sizeof(TWI0));
+	memset((void*)&PORTB, 0, sizeof(PORTB));
+	memset((void*)&RTC, 0, sizeof(RTC));
+	bus.fault = fault;
+	bus.faultCount = faultCount;
+	bus.stuckClocks = stuckClocks;
+	RTC.CNT.value = time;
+	simInterruptsEnabled = 1;
+
+	TWI_Disable();
+	TWI_MasterInit();
+	TWI_MasterClearErrors();
+	bus.starts = 0;
+}
+
+
+struct Completion
+{
+	uint8_t order[4];
+	uint8_t count;
+	bool interruptsEnabled;		/* A callback ran with interrupts enabled (not ISR context) */
+};
+
+static Completion completion;
+
+static void onComplete(TWI_TRANSACTION_t* transaction)
+{
+	completion.order[completion.count++ & 0x03] = transaction->flags >> 4;
+	completion.interruptsEnabled |= (simInterruptsEnabled != 0);
+}
+
+
+struct Expected
+{
+	uint8_t result;
+	uint8_t timeouts, busErrors, nacks, recoveries;
+};
+
+static bool checkErrors(const Expected& expected)
+{
+	const TWIM_ERRORS_t* errors = TWI_MasterErrors();
+	return errors->timeouts == expected.timeouts && errors->bus_errors == expected.busErrors
+		&& errors->nacks == expected.nacks && errors->recoveries == expected.recoveries;
+}
+
+
+/* AHT20 style measurement: command write, repeated START, read. The application may be busy
+ * for a while after submitting, before it waits for the result. */
+static uint8_t measure(uint8_t* data, uint16_t busyTicks = 0)
+{
+	static uint8_t command[3] = { 0xAC, 0x33, 0x00 };
+	TWI_TRANSACTION_t transaction = {};
+	transaction.slave_address = SLAVE_ADDRESS;
+	transaction.write_data = command;
+	transaction.bytes_to_write = sizeof(command);
+	transaction.read_data = data;
+	transaction.bytes_to_read = 6;
+	transaction.flags = TWIM_FLAG_SEND_STOP;
+	TWI_MasterSubmit(&transaction);
+	RTC.CNT.value += busyTicks;
+	return TWI_MasterWait(&transaction);
+}
+
+
+/* A clean measurement after a fault, i.e. the driver and the bus have recovered */
+static bool recovered()
+{
+	uint8_t data[6] = {};
+	uint8_t stops = bus.stops;
+	return measure(data) == TWIM_RESULT_OK && memcmp(data, slaveData, sizeof(data)) == 0
+		&& bus.stops == stops + 1 && bus.pitWakeups == 0;
+}
+
+
+static bool runSingle(const char* name, Fault fault, uint8_t faultCount, uint8_t stuckClocks, uint16_t time,
+	const Expected& expected, uint8_t expectedClocks = 0, uint16_t busyTicks = 0)
+{
+	uint8_t data[6] = {};
+	simReset(fault, faultCount, stuckClocks, time);
+
+	uint8_t result = measure(data, busyTicks);
+	uint16_t elapsed = RTC.CNT.value - time;
+	uint8_t starts = bus.starts;
+	uint8_t clocks = bus.sclPulses;
+
+	bool passed = (result == expected.result) && checkErrors(expected) && (bus.pitWakeups == 0);
+	if (expected.result == TWIM_RESULT_OK)
+	{
+		passed &= (memcmp(data, slaveData, sizeof(data)) == 0) && (bus.stops == 1);
+	}
+	if (expected.result == TWIM_RESULT_TIMEOUT)
+	{
+		/* Detected right after the deadline (not after a PIT period), SDA released by the recovery */
+		passed &= (elapsed > TWI_TIMEOUT_TICKS) && (elapsed <= TWI_TIMEOUT_TICKS + RTC_SYNC_TICKS) && (bus.sclPulses == expectedClocks + 1)
+			&& (bus.pinStops == (bus.sdaHeld ? 0 : 1))
+			&& (TWI0.MCTRLA.value & TWI_ENABLE_bm);
+	}
+	if (!bus.sdaHeld)
+	{
+		passed &= recovered();
+	}
+
+	printf("%-36s %s, result %u, %u ticks, %u starts, %u recovery clocks\n", name, passed ? "passed" : "FAILED",
+		result, elapsed, starts, clocks);
+	return passed;
+}
+
+
+static bool runQueue(const char* name, Fault fault, uint8_t expectedResult)
+{
+	static uint8_t command[3] = { 0xAC, 0x33, 0x00 };
+	uint8_t data[3][6] = {};
+	TWI_TRANSACTION_t transactions[3] = {};
+
+	simReset(fault, 1, 1, 0);
+	memset(&completion, 0, sizeof(completion));
+
+	for (uint8_t i = 0; i < 3; ++i)
+	{
+		transactions[i].on_complete = onComplete;
+		transactions[i].slave_address = SLAVE_ADDRESS;
+		transactions[i].write_data = command;
+		transactions[i].bytes_to_write = sizeof(command);
+		transactions[i].read_data = data[i];
+		transactions[i].bytes_to_read = 6;
+		transactions[i].flags = TWIM_FLAG_SEND_STOP | (i << 4);
+	}
+	/* Queued before the first one can finish, i.e. chained with repeated STARTs */
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		for (uint8_t i = 0; i < 3; ++i)
+		{
+			TWI_MasterSubmit(&transactions[i]);
+		}
+	}
+	TWI_MasterWait(&transactions[2]);
+
+	bool passed = (completion.count == 3) && !completion.interruptsEnabled && (bus.pitWakeups == 0);
+	for (uint8_t i = 0; i < 3; ++i)
+	{
+		passed &= (transactions[i].result == expectedResult) && (completion.order[i] == i);
+	}
+	passed &= (expectedResult != TWIM_RESULT_OK) || (bus.stops == 1);
+	uint8_t stops = bus.stops;
+	passed &= recovered();
+
+	printf("%-36s %s, results %u %u %u, %u callbacks%s, %u stops\n", name, passed ? "passed" : "FAILED",
+		transactions[0].result, transactions[1].result, transactions[2].result, completion.count,
+		completion.interruptsEnabled ? " (interrupts enabled)" : "", stops);
+	return passed;
+}
+
+
+int main()
+{
+	bool passed = true;
+
+	passed &= runSingle("clean transaction", FAULT_NONE, 0, 0, 100, { TWIM_RESULT_OK, 0, 0, 0, 0 });
+	passed &= runSingle("address NACK", FAULT_ADDRESS_NACK, 1, 0, 100, { TWIM_RESULT_NACK_RECEIVED, 0, 0, 1, 0 });
+	passed &= runSingle("data NACK", FAULT_DATA_NACK, 1, 0, 100, { TWIM_RESULT_NACK_RECEIVED, 0, 0, 1, 0 });
+	passed &= runSingle("bus error", FAULT_BUS_ERROR, 1, 0, 100, { TWIM_RESULT_BUS_ERROR, 0, 1, 0, 0 });
+	passed &= runSingle("arbitration lost, retried", FAULT_ARBITRATION_LOST, 2, 0, 100, { TWIM_RESULT_OK, 0, 0, 0, 0 });
+	passed &= runSingle("SDA stuck, released", FAULT_STUCK, 1, 5, 100, { TWIM_RESULT_TIMEOUT, 1, 0, 0, 1 }, 5);
+	passed &= runSingle("SDA stuck, timestamp wraps", FAULT_STUCK, 1, 3, 0xFFF0, { TWIM_RESULT_TIMEOUT, 1, 0, 0, 1 }, 3);
+	passed &= runSingle("SDA stuck for good", FAULT_STUCK, 1, 0, 100, { TWIM_RESULT_TIMEOUT, 1, 0, 0, 1 }, 9);
+	/* Waiting starts shortly before the deadline, a compare match armed now could be missed */
+	for (uint16_t busyTicks = TWI_TIMEOUT_TICKS - 4; busyTicks <= TWI_TIMEOUT_TICKS; ++busyTicks)
+	{
+		char name[40];
+		snprintf(name, sizeof(name), "SDA stuck, waiting after %u ticks", busyTicks);
+		passed &= runSingle(name, FAULT_STUCK, 1, 5, 100, { TWIM_RESULT_TIMEOUT, 1, 0, 0, 1 }, 5, busyTicks);
+	}
+	passed &= runQueue("queue, chained", FAULT_NONE, TWIM_RESULT_OK);
+	passed &= runQueue("queue, aborted", FAULT_STUCK, TWIM_RESULT_TIMEOUT);
+
+	return passed ? 0 : 1;
+}
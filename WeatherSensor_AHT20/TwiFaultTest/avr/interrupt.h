@@ -0,0 +1,17 @@
+/*
+ * avr/interrupt.h
+ *
+ * Host simulation of the global interrupt flag (TwiFaultTest).
+ * Pending interrupts are serviced when the CPU sleeps or an atomic block
+ * restores enabled interrupts, see TwiFaultTest.cpp.
+ */ 
+
+#pragma once
+
+#include <stdint.h>
+
+extern volatile uint8_t simInterruptsEnabled;
+
+#define sei()							(simInterruptsEnabled = 1)
+#define cli()							(simInterruptsEnabled = 0)
+#define ISR(_vector_)					void _vector_(void)
@@ -0,0 +1,100 @@
+/*
+ * avr/io.h
+ *
+ * Host simulation of the ATtiny816 registers used by twi.c (TwiFaultTest).
+ * Registers with side effects are proxies forwarding accesses to the bus
+ * model in TwiFaultTest.cpp.
+ */ 
+
+#pragma once
+
+#include <stdint.h>
+
+typedef volatile uint8_t register8_t;
+typedef volatile uint16_t register16_t;
+
+template <typename T>
+struct SimRegister
+{
+	T value;
+
+	T operator=(T v) { simWrite(this, v); return v; }
+	operator T() { return simRead(this); }
+	SimRegister& operator|=(T v) { simWrite(this, (T)(simRead(this) | v)); return *this; }
+	SimRegister& operator&=(T v) { simWrite(this, (T)(simRead(this) & v)); return *this; }
+};
+
+typedef SimRegister<uint8_t> simreg8_t;
+typedef SimRegister<uint16_t> simreg16_t;
+
+void simWrite(simreg8_t* reg, uint8_t value);
+void simWrite(simreg16_t* reg, uint16_t value);
+uint8_t simRead(simreg8_t* reg);
+uint16_t simRead(simreg16_t* reg);
+
+#define PIN0_bm							0x01
+#define PIN1_bm							0x02
+#define PIN2_bm							0x04
+#define PIN3_bm							0x08
+#define PIN4_bm							0x10
+#define PIN5_bm							0x20
+#define PIN6_bm							0x40
+#define PIN7_bm							0x80
+
+typedef struct PORT_struct {
+	simreg8_t DIR, DIRSET, DIRCLR, DIRTGL, OUT, OUTSET, OUTCLR, OUTTGL, IN, INTFLAGS;
+	simreg8_t PIN0CTRL, PIN1CTRL, PIN2CTRL, PIN3CTRL, PIN4CTRL, PIN5CTRL, PIN6CTRL, PIN7CTRL;
+} PORT_t;
+extern PORT_t PORTA, PORTB, PORTC;
+#define PORT_PULLUPEN_bm				0x08
+
+typedef enum TWI_BUSSTATE_enum {
+	TWI_BUSSTATE_UNKNOWN_gc = 0,
+	TWI_BUSSTATE_IDLE_gc = 1,
+	TWI_BUSSTATE_OWNER_gc = 2,
+	TWI_BUSSTATE_BUSY_gc = 3,
+} TWI_BUSSTATE_t;
+
+typedef struct TWI_struct {
+	simreg8_t CTRLA, DBGCTRL, MCTRLA, MCTRLB, MSTATUS, MBAUD, MADDR, MDATA;
+	simreg8_t SCTRLA, SCTRLB, SSTATUS, SADDR, SDATA, SADDRMASK;
+} TWI_t;
+extern TWI_t TWI0;
+#define TWI_FMPEN_bm					0x02
+#define TWI_RIEN_bm						0x80
+#define TWI_WIEN_bm						0x40
+#define TWI_ENABLE_bm					0x01
+#define TWI_FLUSH_bm					0x08
+#define TWI_ACKACT_bm					0x04
+#define TWI_MCMD_gm						0x03
+#define TWI_MCMD_REPSTART_gc			0x01
+#define TWI_MCMD_RECVTRANS_gc			0x02
+#define TWI_MCMD_STOP_gc				0x03
+#define TWI_RIF_bm						0x80
+#define TWI_WIF_bm						0x40
+#define TWI_CLKHOLD_bm					0x20
+#define TWI_RXACK_bm					0x10
+#define TWI_ARBLOST_bm					0x08
+#define TWI_BUSERR_bm					0x04
+#define TWI_BUSSTATE_gm					0x03
+
+typedef struct RTC_struct {
+	simreg8_t CTRLA, STATUS, INTCTRL, INTFLAGS, TEMP, DBGCTRL, CALIB, CLKSEL;
+	simreg16_t CNT, PER, CMP;
+} RTC_t;
+extern RTC_t RTC;
+#define RTC_OVF_bm						0x01
+#define RTC_CMP_bm						0x02
+#define RTC_CTRLABUSY_bm				0x01
+#define RTC_CNTBUSY_bm					0x02
+#define RTC_PERBUSY_bm					0x04
+#define RTC_CMPBUSY_bm					0x08
+
+typedef struct SLPCTRL_struct {
+	register8_t CTRLA;
+} SLPCTRL_t;
+extern SLPCTRL_t SLPCTRL;
+#define SLPCTRL_SEN_bm					0x01
+#define SLPCTRL_SMODE_IDLE_gc			0x00
+#define SLPCTRL_SMODE_STDBY_gc			0x02
+#define SLPCTRL_SMODE_PDOWN_gc			0x04
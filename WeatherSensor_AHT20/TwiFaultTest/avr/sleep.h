@@ -0,0 +1,11 @@
+/*
+ * avr/sleep.h
+ *
+ * Host simulation of SLEEP (TwiFaultTest).
+ */ 
+
+#pragma once
+
+void simSleep(void);
+
+#define sleep_cpu()						simSleep()
@@ -0,0 +1,10 @@
+/*
+ * util/delay.h
+ *
+ * Host simulation of busy waits (TwiFaultTest), time is not modelled.
+ */ 
+
+#pragma once
+
+#define _delay_us(_us_)					((void)(_us_))
+#define _delay_ms(_ms_)					((void)(_ms_))
@@ -46,6 +46,8 @@
 #define F_CPU_FULLSPEED					1000000UL
 #define F_CPU							F_CPU_FULLSPEED
 #define F_CPU_UART						F_CPU_FULLSPEED /* Desired CPU clock during USART operation */
+//#define ENABLE_DEBUG									/* Debug output on USART0 (Debug.h), set for all translation units */
+//#define ENABLE_PROFILING								/* Active cycles per state on TCA0, dumped via debug output (Profiling.h) */
 
 #define TCB0_RUNNING					(TCB0.STATUS & TCB_RUN_bm)
 #define START_TCB0()					TCB0.CTRLA |= TCB_ENABLE_bm
@@ -54,12 +56,20 @@
 #define UNLOCK_PROTECTED_REGISTERS()	CCP = CCP_IOREG_gc
 
 /* Used by TWI library */
+//#define TWI_ENABLE_SLAVE								/* Build TWI slave support (twi_slave.c), the sensor is master only */
+#define TWI_PORT						PORTB
 #define CONFIGURE_TWI_IO() { \
 	PORTB.PIN0CTRL = PORT_PULLUPEN_bm; \
 	PORTB.PIN1CTRL = PORT_PULLUPEN_bm; \
 }
 
 #define F_CPU_TWI						F_CPU_FULLSPEED	/* Desired CPU clock during TWI operation */
-#define F_SCL							100000UL
-#define OVERRIDE_TWI_BAUD
-#define TWI_BAUD_VALUE					0				/* fSCL = 100kHz, fCPU = 1 MHz */
+#define F_SCL							400000UL		/* Max. SCL supported by the slaves (AHT20: Fast-mode), actual SCL depends on F_CPU_TWI */
+//#define TWI_T_RISE					1000			/* Measured SCL/SDA rise time [ns], default: worst case of the selected mode */
+#define TWI_TIMESTAMP()					RTC.CNT			/* Free-running RTC counter (see setup()) */
+#define TWI_TIMESTAMP_HZ				1024UL
+#define TWI_TIMEOUT_MS					20
+#define TWI_IDLE_SLEEP									/* Sleep (IDLE) in TWI_MasterWait() instead of spinning */
+#define TWI_WAKEUP_ARM(_timestamp_)		((RTC.STATUS & RTC_CMPBUSY_bm) ? 0 : \
+										 (RTC.CMP = (_timestamp_), RTC.INTFLAGS = RTC_CMP_bm, RTC.INTCTRL |= RTC_CMP_bm, 1))
+#define TWI_WAKEUP_DISARM()				RTC.INTCTRL &= ~RTC_CMP_bm
@@ -5,10 +5,15 @@
 #include <avr/interrupt.h>
 #include <stdlib.h>
 
-// #define ENABLE_DEBUG
 #include "Debug.h"
+#include "Profiling.h"
 #include "AHTX0.h"						// Original source: https://github.com/adafruit/Adafruit_AHTX0
 
+extern "C"
+{
+#include "twi.h"
+}
+
 
 #define DATA_BITS						41
 #define PREAMBLE_BITS					8
@@ -17,6 +22,9 @@
 #define PACKET_LENGTH_BYTES				(PACKET_LENGTH_BITS / BITS_PER_BYTE)
 #define PACKET_COUNT					15
 
+#define SENSOR_MAX_BUSY_POLLS			10		/* x 50 ms */
+#define SENSOR_RETRY_BACKOFF_MAX		15		/* Max. measurement cycles (x 60 s) between re-init attempts */
+
 
 const uint8_t sensorChannel = 3;
 
@@ -34,7 +42,12 @@ enum OperationStates {
 
 
 AHTX0 sensor;
+#ifdef ENABLE_DEBUG
 SerialDebugging debug;
+#endif
+#ifdef ENABLE_PROFILING
+StateProfiler profiler;
+#endif
 
 typedef void (*FPinterruptHandler)(void);
 volatile FPinterruptHandler fpInterruptHandler;
@@ -46,6 +59,9 @@ volatile uint8_t currentBit;
 
 static uint8_t packetCount;
 static uint8_t id;
+static uint8_t sensorPolls;
+static uint8_t sensorErrors;				// Consecutive failed measurement cycles, 0 = sensor OK
+static uint8_t sensorRetryCountdown;
 
 
 void configureFullSpeed(void)
@@ -88,6 +104,14 @@ ISR(RTC_PIT_vect) // Every 4s - first interval is undefined (anything between 0.
 }
 
 
+ISR(RTC_CNT_vect) // Compare match: TWI timeout wake-up (see TWI_WAKEUP_ARM)
+{
+	uint8_t sreg = SREG;
+	RTC.INTFLAGS = RTC_CMP_bm | RTC_OVF_bm;
+	SREG = sreg;
+}
+
+
 ISR(TCB0_INT_vect)
 {
 	uint8_t sreg = SREG;
@@ -160,12 +184,7 @@ void transmit_handler()
 
 void assemblePacket(const uint8_t id, const uint8_t battLow, const uint8_t test, const uint8_t channel, const int16_t temperature, const uint8_t humidity)
 {
-	DEBUG_BYTE('#');
-	DEBUG_VALUE(id);
-	DEBUG_BYTE('t');
-	DEBUG_VALUE(temperature);
-	DEBUG_BYTE('h');
-	DEBUG_VALUE(humidity);
+	DEBUG_EVENT(TRACE_SENSOR_DATA, id, temperature, humidity);
 	
 	if ((channel == 0) || (humidity > 100) || (temperature < -677) || (temperature > 1590))
 	{
@@ -184,18 +203,22 @@ void assemblePacket(const uint8_t id, const uint8_t battLow, const uint8_t test,
 }
 
 
-void prepareSensorData()
+bool prepareSensorData()
 {
 	static uint8_t testButtonPressed = 1;
 	
 	int32_t temperature;
 	uint32_t humidity;
-	sensor.readData(humidity, temperature); // Returns 1/10 centigrade
+	if (!sensor.readData(humidity, temperature)) // Returns 1/10 centigrade
+	{
+		return false;
+	}
 	
 	const uint8_t batteryLow = BOD.STATUS & BOD_VLMS_bm;
 	assemblePacket(id, batteryLow, testButtonPressed, sensorChannel, (int16_t)temperature, (uint8_t)humidity);
 	
 	testButtonPressed = 0; // Only set the first time
+	return true;
 }
 
 
@@ -224,6 +247,9 @@ void setup(void)
 	// Configure RTC to 4s PIT
 	while (RTC.STATUS != 0);
 	RTC.CLKSEL = RTC_CLKSEL_INT1K_gc;
+	// Free-running RTC counter @ 1024 Hz for TWI timeouts (stops in power down, PIT keeps running)
+	RTC.PER = 0xFFFF;
+	RTC.CTRLA = RTC_PRESCALER_DIV1_gc | RTC_RTCEN_bm;
 	RTC.PITINTCTRL = RTC_PI_bm;
 	while ((RTC.PITSTATUS & RTC_CTRLBUSY_bm) != 0);
 	RTC.PITCTRLA = RTC_PERIOD_CYC4096_gc | RTC_PITEN_bm;
@@ -238,8 +264,10 @@ void setup(void)
 #ifdef ENABLE_DEBUG
 	debug.begin();
 #endif
+	PROFILE_INIT();
 
 	sei();
+	DEBUG_EVENT(TRACE_BOOT);
 	
 	if (!sensor.begin())
 	{
@@ -248,25 +276,60 @@ void setup(void)
 }
 
 
+// Enter the sleep mode configured in SLPCTRL - but not while debug output is still being
+// transmitted: the USART clock stops in STANDBY/POWERDOWN, so fall back to IDLE until done.
+static inline void goToSleep()
+{
+#ifdef ENABLE_DEBUG
+	if (debug.isBusy())
+	{
+		uint8_t sleepCtrl = SLPCTRL.CTRLA;
+		SLPCTRL.CTRLA = SLPCTRL_SMODE_IDLE_gc | SLPCTRL_SEN_bm;
+		sleep_cpu();
+		SLPCTRL.CTRLA = sleepCtrl;
+		return;
+	}
+#endif
+	sleep_cpu();
+}
+
+
 void loop(void)
 {
+	PROFILE_ENTER(opState);
 	
 	switch (opState)
 	{
 		case PREPARE_POWERDOWN:
+			PROFILE_DUMP_PERIODIC();
+			DEBUG_FLUSH(); // Baud rate is only valid at F_CPU_UART
 			configureLowSpeed();
 			SLPCTRL.CTRLA = SLPCTRL_SMODE_PDOWN_gc | SLPCTRL_SEN_bm;
 			opState = WAIT_FOR_READ;
 			
 		case WAIT_FOR_READ:
-			sleep_cpu();
+			goToSleep();
 			break;
 			
 		case TRIGGER_SENSOR_READ:
+			// Fallback after errors: back off, then try to bring the sensor up again
+			if (sensorErrors > 0 && --sensorRetryCountdown > 0)
+			{
+				// Still at low speed with POWERDOWN selected - sleep on, skipping PREPARE_POWERDOWN
+				// (the profile dump / debug flush there needs the UART clock of full speed)
+				opState = WAIT_FOR_READ;
+				break;
+			}
 			configureFullSpeed();
+			if (sensorErrors > 0 && !sensor.begin())
+			{
+				opState = ERROR;
+				break;
+			}
 			if (!sensor.triggerRead())
 			{
 				opState = ERROR;
+				break;
 			}
 			// Prepare for standby sleep mode
 			SLPCTRL.CTRLA = SLPCTRL_SMODE_STDBY_gc | SLPCTRL_SEN_bm;
@@ -274,19 +337,30 @@ void loop(void)
 			fpInterruptHandler = 0;
 			TCB0.CCMP = 50000;
 			START_TCB0();
+			sensorPolls = SENSOR_MAX_BUSY_POLLS;
 			opState = WAIT_FOR_SENSOR;
 			
 		case WAIT_FOR_SENSOR:
-			sleep_cpu();
+			goToSleep();
 			if (!sensor.isBusy())
 			{
 				STOP_TCB0();
 				opState = READ_SENSOR;
 			}
+			else if (--sensorPolls == 0)
+			{
+				// Sensor stuck busy or bus dead (failed reads return busy)
+				opState = ERROR;
+			}
 			break;
 			
 		case READ_SENSOR:
-			prepareSensorData();
+			if (!prepareSensorData())
+			{
+				opState = ERROR;
+				break;
+			}
+			sensorErrors = 0;
 			// Initiate transmission
 			TXPWR_ON();
 			packetCount = PACKET_COUNT;
@@ -309,7 +383,7 @@ void loop(void)
 			if (TCB0_RUNNING)
 			{
 				// Let interrupt handler do its job
-				sleep_cpu();
+				goToSleep();
 			}
 			else
 			{
@@ -327,10 +401,22 @@ void loop(void)
 			break;
 			
 		case ERROR:
-			LED_ON();
-			configureLowSpeed();
-			while(1);
+			// No infinite spin here - it would keep the CPU awake and drain the batteries.
+			// Go back to sleep and retry with increasing back-off on the next measurement cycles.
+			STOP_TCB0();
+			TXPWR_OFF();
+			DEBUG_EVENT(TRACE_TWI_ERRORS, TWI_MasterErrors()->timeouts, TWI_MasterErrors()->bus_errors, TWI_MasterErrors()->nacks);
+			TWI_MasterClearErrors(); // A stuck bus has already been recovered by the TWI driver
+			if (sensorErrors < 0xFF)
+			{
+				++sensorErrors;
+			}
+			sensorRetryCountdown = (sensorErrors < SENSOR_RETRY_BACKOFF_MAX) ? sensorErrors : SENSOR_RETRY_BACKOFF_MAX;
+			opState = PREPARE_POWERDOWN;
+			break;
 	}
+	
+	PROFILE_LEAVE();
 }
 
 
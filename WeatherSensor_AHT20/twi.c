@@ -23,6 +23,11 @@
 #include "twi.h"
 
 #include <avr/interrupt.h>
+#ifdef TWI_IDLE_SLEEP
+#include <avr/sleep.h>
+#endif
+#include <util/atomic.h>
+#include <util/delay.h>
 
 #ifndef true
 #define true 1
@@ -33,33 +38,19 @@
 #endif
 
 /* Master variables */
-static register8_t  master_slaveAddress;                       /*!< Slave address */
-static register8_t* master_writeData;                          /*!< Data to write */
-static register8_t* master_readData;                           /*!< Read data */
-static register8_t  master_bytesToWrite;                       /*!< Number of bytes to write */
-static register8_t  master_bytesToRead;                        /*!< Number of bytes to read */
+static TWI_TRANSACTION_t* volatile master_queueHead;           /*!< Transaction currently on the bus */
+static TWI_TRANSACTION_t* volatile master_queueTail;           /*!< Last queued transaction */
 static register8_t  master_bytesWritten;                       /*!< Number of bytes written */
 static register8_t  master_bytesRead;                          /*!< Number of bytes read */
-static register8_t  master_sendStop;                           /*!< To send a stop at the end of the transaction or not */
-static register8_t  master_trans_status;                       /*!< Status of transaction */
-static register8_t  master_result;                             /*!< Result of transaction */
-
-/* Slave variables */
-static uint8_t (*TWI_onSlaveTransmit)(void) __attribute__((unused));
-static void (*TWI_onSlaveReceive)(int) __attribute__((unused));
-static register8_t* slave_writeData;
-static register8_t* slave_readData;
-static register8_t  slave_bytesToWrite;
-static register8_t  slave_bytesWritten;
-static register8_t  slave_bytesToRead;
-static register8_t  slave_bytesRead;
-static register8_t  slave_trans_status;
-static register8_t  slave_result;
-static register8_t  slave_callUserReceive;
-static register8_t  slave_callUserRequest;
-
-/* TWI module mode */
-static volatile TWI_MODE_t twi_mode;
+#ifdef TWI_TIMESTAMP
+static volatile uint16_t master_startTime;                     /*!< Timestamp the current transaction was put on the bus */
+#endif
+static TWIM_ERRORS_t master_errors;                            /*!< Error counters */
+
+#define TWI_COUNT_ERROR(_counter_)	if (master_errors._counter_ < 0xFF) { master_errors._counter_++; }
+
+/* TWI module mode, shared with twi_slave.c */
+volatile TWI_MODE_t twi_mode;
 
 /*! \brief Initialize the TWI module as a master.
  *
@@ -80,43 +71,15 @@ void TWI_MasterInit()
 	
 	master_bytesRead = 0;
 	master_bytesWritten = 0;
-	master_trans_status = TWIM_STATUS_READY;
-	master_result = TWIM_RESULT_UNKNOWN;
+	master_queueHead = 0;
+	master_queueTail = 0;
 	
-	TWI0.MCTRLA = TWI_RIEN_bm | TWI_WIEN_bm | TWI_ENABLE_bm;
+	/* Baud rate and Fm+ must be configured while the master is disabled */
 	TWI_MasterSetBaud();
+	TWI0.MCTRLA = TWI_RIEN_bm | TWI_WIEN_bm | TWI_ENABLE_bm;
 	TWI0.MSTATUS = TWI_BUSSTATE_IDLE_gc;
 }
 
-/*! \brief Initialize the TWI module as a slave.
- *
- *  TWI slave initialization function.
- *  Enables slave address/stop and data interrupts.
- *  Assigns slave's own address.
- *  Remember to enable interrupts globally from the main application.
- *
- *  \param address				    The TWI Slave's own address.
- */
-void TWI_SlaveInit(uint8_t address)
-{
-	if(twi_mode != TWI_MODE_UNKNOWN) return;
-	
-	twi_mode = TWI_MODE_SLAVE;
-	
-	slave_bytesRead = 0;
-	slave_bytesWritten = 0;
-	slave_trans_status = TWIS_STATUS_READY;
-	slave_result = TWIS_RESULT_UNKNOWN;
-	slave_callUserRequest = 0;
-	slave_callUserReceive = 0;
-	
-	TWI0.SADDR = address << 1;	
-	TWI0.SCTRLA = TWI_DIEN_bm | TWI_APIEN_bm | TWI_PIEN_bm  | TWI_ENABLE_bm;
-	
-	/* Bus Error Detection circuitry needs Master enabled to work */
-	TWI0.MCTRLA = TWI_ENABLE_bm;
-}
-
 void TWI_Flush(void){
 	TWI0.MCTRLB |= TWI_FLUSH_bm;
 }
@@ -171,59 +134,287 @@ TWI_BUSSTATE_t TWI_MasterState(void)
  */
 uint8_t TWI_MasterReady(void)
 {
-	uint8_t twi_status = (master_trans_status & TWIM_STATUS_READY);
-	return twi_status;
+	return (master_queueHead == 0);
 }
 
 
 /*! \brief Set the TWI baud rate.
  *
- *  Sets the baud rate used by TWI Master.
- *
- *  \param frequency				    The required baud.
+ *  Sets the baud rate used by TWI Master as computed at compile time
+ *  (see TWI_BAUD_VALUE in twi.h).
  */
 void TWI_MasterSetBaud(void){
-#ifndef OVERRIDE_TWI_BAUD
-// See Datasheet / Electrical Characteristics. F values in Hertz, T values in nanoseconds
-#  if (F_SCL) <= 100000
-#    define T_RISE			1000
-#    define T_LOW_MIN		4700
-#    define T_OF			250
-#  elif (F_SCL) <= 400000
-#    define T_RISE			300
-#    define T_LOW_MIN		1300
-#    define T_OF			250
-#  elif (F_SCL) <= 1000000
-#    define T_RISE			120
-#    define T_LOW_MIN		500
-#    define T_OF			120
-#  else
-#    error "TWI SCL frequency outside specifications!"
-#  endif
-
-#  define TWI_BAUD_VALUE	(((F_CPU) / (2 * (F_SCL))) - (5 + ((F_CPU) * ((T_RISE) / 1000000000) / 2)))
-#  define T_LOW				((((TWI_BAUD_VALUE) + 5) / (F_CPU)) - ((T_OF) / 1000000000))
-
-#  if (T_LOW) < (T_LOW_MIN)
-#    undef TWI_BAUD_VALUE
-#    define TWI_BAUD_VALUE	((F_CPU) * ((T_LOW_MIN) + ((T_OF) / 1000000000)) - 5)
-#  endif
+#ifdef TWI_FAST_MODE_PLUS
+	TWI0.CTRLA |= TWI_FMPEN_bm;
+#else
+	TWI0.CTRLA &= ~TWI_FMPEN_bm;
 #endif
 	TWI0.MBAUD = (uint8_t)TWI_BAUD_VALUE;
 }
 
 
+/*! \brief Check if TWI is configured as master.
+ *
+ *  \retval true  If TWI master is initialized (idle or busy).
+ *  \retval false Otherwise.
+ */
+static uint8_t TWI_IsMasterMode(void)
+{
+	return (twi_mode == TWI_MODE_MASTER) ||
+	       (twi_mode == TWI_MODE_MASTER_TRANSMIT) ||
+	       (twi_mode == TWI_MODE_MASTER_RECEIVE);
+}
+
+
+/*! \brief Put transaction onto the bus.
+ *
+ *  Sends START (or repeated START if the bus is still owned from a chained
+ *  transaction) + Address + 'R/_W'. Must be called with interrupts disabled
+ *  or from ISR context.
+ *
+ *  \param transaction  The transaction to start.
+ */
+static void TWI_MasterStartTransaction(TWI_TRANSACTION_t* transaction)
+{
+	master_bytesWritten = 0;
+	master_bytesRead = 0;
+#ifdef TWI_TIMESTAMP
+	master_startTime = TWI_TIMESTAMP();
+#endif
+
+	uint8_t address = transaction->slave_address << 1;
+
+	/* If read-only command, send the START condition + Address +
+	 * 'R/_W = 1'. Otherwise (write or address probe) 'R/_W = 0'.
+	 */
+	if (transaction->bytes_to_write == 0 && transaction->bytes_to_read > 0) {
+		twi_mode = TWI_MODE_MASTER_RECEIVE;
+		TWI0.MADDR = ADD_READ_BIT(address);
+	} else {
+		twi_mode = TWI_MODE_MASTER_TRANSMIT;
+		TWI0.MADDR = ADD_WRITE_BIT(address);
+	}
+}
+
+
+/*! \brief Queue a master transaction.
+ *
+ *  Appends the caller-owned descriptor to the transaction queue and starts
+ *  it immediately if the bus is idle. Returns without waiting, completion
+ *  is signalled through transaction->result and the optional on_complete
+ *  callback. If the queue is not empty when the current transaction ends,
+ *  the next one follows with a repeated START instead of STOP + START.
+ *
+ *  \param transaction  The transaction descriptor.
+ *
+ *  \retval true  If transaction was queued.
+ *  \retval false If TWI is not configured as master.
+ */
+uint8_t TWI_MasterSubmit(TWI_TRANSACTION_t* transaction)
+{
+	if (!TWI_IsMasterMode()) return false;
+
+	transaction->next = 0;
+	transaction->bytes_read = 0;
+	transaction->result = TWIM_RESULT_UNKNOWN;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if (master_queueHead == 0) {
+			master_queueHead = transaction;
+			master_queueTail = transaction;
+			TWI_MasterStartTransaction(transaction);
+		} else {
+			master_queueTail->next = transaction;
+			master_queueTail = transaction;
+		}
+	}
+	return true;
+}
+
+
+#ifdef TWI_IDLE_SLEEP
+/*! \brief Sleep until the next interrupt unless the transaction has finished.
+ *
+ *  The result is checked with interrupts disabled and SEI directly precedes
+ *  SLEEP, so a TWI interrupt finishing the transaction in between cannot be
+ *  missed: it is serviced only after the CPU has entered sleep and wakes it
+ *  up again. The application's sleep mode setting is restored afterwards.
+ *  Returns without sleeping if the wake-up is too close to be armed safely
+ *  (see TWI_WAKEUP_MARGIN_TICKS).
+ *
+ *  \param transaction  The transaction descriptor.
+ *  \param wakeup       TWI_TIMESTAMP() value to be woken up at at the latest.
+ */
+static void TWI_MasterSleep(TWI_TRANSACTION_t* transaction, uint16_t wakeup)
+{
+	uint8_t sleepCtrl = SLPCTRL.CTRLA;
+
+	cli();
+	if (transaction->result == TWIM_RESULT_UNKNOWN) {
+#ifdef TWI_TIMESTAMP
+		if (((int16_t)(wakeup - TWI_TIMESTAMP()) <= TWI_WAKEUP_MARGIN_TICKS) || !(TWI_WAKEUP_ARM(wakeup))) {
+			sei();
+			return;
+		}
+#else
+		(void)wakeup;
+#endif
+		SLPCTRL.CTRLA = SLPCTRL_SMODE_IDLE_gc | SLPCTRL_SEN_bm;
+		sei();
+		sleep_cpu();
+		SLPCTRL.CTRLA = sleepCtrl;
+	}
+	sei();
+}
+#endif
+
+
+/*! \brief Wait for a queued transaction.
+ *
+ *  Blocks until the given transaction has finished. If the transaction on
+ *  the bus does not finish within TWI_TIMEOUT_MS (e.g. a slave holding SDA
+ *  low after a brown-out), all queued transactions are aborted with
+ *  TWIM_RESULT_TIMEOUT and the bus is recovered.
+ *  With TWI_IDLE_SLEEP, the CPU sleeps in IDLE mode between interrupts.
+ *  Requires global interrupts to be enabled.
+ *
+ *  \param transaction  The transaction descriptor.
+ *
+ *  \return The TWIM_RESULT_t of the transaction.
+ */
+uint8_t TWI_MasterWait(TWI_TRANSACTION_t* transaction)
+{
+	while (transaction->result == TWIM_RESULT_UNKNOWN) {
+		uint16_t wakeup = 0;
+#ifdef TWI_TIMESTAMP
+		uint16_t startTime;
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+			startTime = master_startTime;
+		}
+		if ((uint16_t)(TWI_TIMESTAMP() - startTime) > TWI_TIMEOUT_TICKS) {
+			TWI_COUNT_ERROR(timeouts);
+			TWI_MasterAbort(TWIM_RESULT_TIMEOUT);
+			break;
+		}
+		wakeup = startTime + TWI_TIMEOUT_TICKS + 1;
+#endif
+#ifdef TWI_IDLE_SLEEP
+		TWI_MasterSleep(transaction, wakeup);
+#else
+		(void)wakeup;
+#endif
+	}
+#if defined(TWI_IDLE_SLEEP) && defined(TWI_TIMESTAMP)
+	TWI_WAKEUP_DISARM();
+#endif
+	return transaction->result;
+}
+
+
+/*! \brief Abort all transactions.
+ *
+ *  Disables the master, finishes all queued transactions with the given
+ *  result, recovers the bus and re-enables the master. The on_complete
+ *  callbacks run with interrupts disabled, like when called from the ISR.
+ *
+ *  \param result  The result reported to the aborted transactions.
+ */
+void TWI_MasterAbort(uint8_t result)
+{
+	TWI_TRANSACTION_t* transaction;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		TWI0.MCTRLA = 0x00;
+		transaction = master_queueHead;
+		master_queueHead = 0;
+		master_queueTail = 0;
+		twi_mode = TWI_MODE_MASTER;
+	}
+
+	TWI_MasterRecoverBus();
+
+	TWI_MasterSetBaud();
+	TWI0.MCTRLA = TWI_RIEN_bm | TWI_WIEN_bm | TWI_ENABLE_bm;
+	TWI0.MSTATUS = TWI_BUSSTATE_IDLE_gc;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		while (transaction) {
+			TWI_TRANSACTION_t* next = transaction->next;
+			transaction->result = result;
+			if (transaction->on_complete) {
+				transaction->on_complete(transaction);
+			}
+			transaction = next;
+		}
+	}
+}
+
+
+/*! \brief Bus recovery.
+ *
+ *  Releases a slave stuck in the middle of a byte (holding SDA low) by
+ *  clocking SCL up to 9 times until SDA is released, followed by a STOP
+ *  condition. The pins are driven open-drain style (DIR toggling, OUT low).
+ *  The TWI master must be disabled.
+ */
+void TWI_MasterRecoverBus(void)
+{
+	TWI_PORT.OUTCLR = SCL_BIT | SDA_BIT;
+	TWI_PORT.DIRCLR = SCL_BIT | SDA_BIT;
+	_delay_us(5);
+
+	for (uint8_t i = 0; (i < 9) && !(TWI_PORT.IN & SDA_BIT); i++) {
+		TWI_PORT.DIRSET = SCL_BIT;
+		_delay_us(5);
+		TWI_PORT.DIRCLR = SCL_BIT;
+		_delay_us(5);
+	}
+
+	/* STOP condition: SDA rising while SCL is high */
+	TWI_PORT.DIRSET = SCL_BIT;
+	_delay_us(5);
+	TWI_PORT.DIRSET = SDA_BIT;
+	_delay_us(5);
+	TWI_PORT.DIRCLR = SCL_BIT;
+	_delay_us(5);
+	TWI_PORT.DIRCLR = SDA_BIT;
+	_delay_us(5);
+
+	TWI_COUNT_ERROR(recoveries);
+}
+
+
+/*! \brief Returns the master error counters.
+ */
+const TWIM_ERRORS_t* TWI_MasterErrors(void)
+{
+	return &master_errors;
+}
+
+
+/*! \brief Resets the master error counters.
+ */
+void TWI_MasterClearErrors(void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		master_errors.timeouts = 0;
+		master_errors.bus_errors = 0;
+		master_errors.nacks = 0;
+		master_errors.recoveries = 0;
+	}
+}
+
+
 /*! \brief TWI write transaction.
  *
  *  This function is TWI Master wrapper for a write-only transaction.
  *
- *  \param twi          The TWI_Master_t struct instance.
  *  \param address      Slave address.
  *  \param writeData    Pointer to data to write.
  *  \param bytesToWrite Number of data bytes to write.
+ *  \param send_stop    Release bus with STOP at the end of the transaction.
  *
- *  \retval true  If transaction could be started.
- *  \retval false If transaction could not be started.
+ *  \retval see TWI_MasterWriteRead
  */
 uint8_t TWI_MasterWrite(uint8_t slave_address,
 					 uint8_t *write_data,
@@ -234,6 +425,7 @@ uint8_t TWI_MasterWrite(uint8_t slave_address,
 						write_data, 
 						bytes_to_write, 
 						0,
+						0,
 						send_stop);
 }
 
@@ -242,26 +434,24 @@ uint8_t TWI_MasterWrite(uint8_t slave_address,
  *
  *  This function is a TWI Master wrapper for read-only transaction.
  *
- *  \param twi            The TWI_Master_t struct instance.
  *  \param address        The slave address.
+ *  \param read_data      Buffer for the read data.
  *  \param bytesToRead    The number of bytes to read.
+ *  \param send_stop      Release bus with STOP at the end of the transaction.
  *
- *  \retval true  If transaction could be started.
- *  \retval false If transaction could not be started.
+ *  \return Number of bytes read.
  */
 uint8_t TWI_MasterRead(uint8_t slave_address,
 					uint8_t* read_data,
 					uint8_t bytes_to_read,
 					uint8_t send_stop)
 {
-	master_readData = read_data;
-
-	uint8_t bytes_read = TWI_MasterWriteRead(slave_address, 
-										  0, 
-										  0, 
-										  bytes_to_read,
-										  send_stop);
-	return bytes_read;
+	return TWI_MasterWriteRead(slave_address, 
+							0, 
+							0, 
+							read_data,
+							bytes_to_read,
+							send_stop);
 }
 
 
@@ -269,14 +459,17 @@ uint8_t TWI_MasterRead(uint8_t slave_address,
  *
  *  This function is a TWI Master write and/or read transaction. The function
  *  can be used to both write and/or read bytes to/from the TWI Slave in one
- *  transaction.
+ *  transaction, the read phase follows the write phase with a repeated START.
+ *  Blocking wrapper around TWI_MasterSubmit() / TWI_MasterWait().
  *
- *  \param twi            The TWI_Master_t struct instance.
  *  \param address        The slave address.
  *  \param writeData      Pointer to data to write.
  *  \param bytesToWrite   Number of bytes to write.
+ *  \param read_data      Buffer for the read data.
  *  \param bytesToRead    Number of bytes to read.
+ *  \param send_stop      Release bus with STOP at the end of the transaction.
  *
+ *  If bytesToRead > 0, the number of bytes read is returned. Otherwise:
  *  \retval 0:success
  *  \retval 1:data too long to fit in transmit buffer
  *  \retval 2:received NACK on transmit of address
@@ -286,86 +479,48 @@ uint8_t TWI_MasterRead(uint8_t slave_address,
 uint8_t TWI_MasterWriteRead(uint8_t slave_address,
                          uint8_t *write_data,
                          uint8_t bytes_to_write,
+                         uint8_t *read_data,
                          uint8_t bytes_to_read,
 						 uint8_t send_stop)
 {
-	if(twi_mode != TWI_MODE_MASTER) return false;
-
-	/*Initiate transaction if bus is ready. */
-	if (master_trans_status == TWIM_STATUS_READY) {
-		
-		master_trans_status = TWIM_STATUS_BUSY;
-		master_result = TWIM_RESULT_UNKNOWN;
-
-		master_writeData = write_data;
-
-		master_bytesToWrite = bytes_to_write;
-		master_bytesToRead = bytes_to_read;
-		master_bytesWritten = 0;
-		master_bytesRead = 0;
-		master_sendStop = send_stop;
-		master_slaveAddress = slave_address<<1;
-
-trigger_action:
-
-		/* If write command, send the START condition + Address +
-		 * 'R/_W = 0'
-		 */
-		if (master_bytesToWrite > 0) {
-			twi_mode = TWI_MODE_MASTER_TRANSMIT;
-			uint8_t writeAddress = ADD_WRITE_BIT(master_slaveAddress);
-			TWI0.MADDR = writeAddress;
-		}
-
-		/* If read command, send the START condition + Address +
-		 * 'R/_W = 1'
-		 */
-		else if (master_bytesToRead > 0) {
-			twi_mode = TWI_MODE_MASTER_RECEIVE;
-			uint8_t readAddress = ADD_READ_BIT(master_slaveAddress);
-			TWI0.MADDR = readAddress;
-		}
-
-		else if (master_bytesToWrite == 0 && master_bytesToRead == 0) {
-			twi_mode = TWI_MODE_MASTER_TRANSMIT;
-			uint8_t writeAddress = ADD_WRITE_BIT(master_slaveAddress);
-			TWI0.MADDR = writeAddress;
-		}
-
-		/* Arduino requires blocking function */
-		while(master_result == TWIM_RESULT_UNKNOWN) {}
-
-		// in case of arbitration lost, retry sending
-		if (master_result == TWIM_RESULT_ARBITRATION_LOST) {
-			goto trigger_action;
-		}
-
-		uint8_t ret = 0;
-		if (master_bytesToRead > 0) {
-			// return bytes really read
-			ret = master_bytesRead;
-		} else {
-			// return 0 if success, >0 otherwise (follow classic AVR conventions)
-			switch (master_result) {
-				case TWIM_RESULT_OK:
-					ret = 0;
-					break;
-				case TWIM_RESULT_BUFFER_OVERFLOW:
-					ret = 1;
-					break;
-				case TWIM_RESULT_NACK_RECEIVED:
-					ret = 3;
-					break;
-				default:
-					ret = 4;
-					break;
-			}
-		}
-
-		return ret;
+	TWI_TRANSACTION_t transaction = {
+		.next = 0,
+		.on_complete = 0,
+		.slave_address = slave_address,
+		.write_data = write_data,
+		.bytes_to_write = bytes_to_write,
+		.read_data = read_data,
+		.bytes_to_read = bytes_to_read,
+		.flags = send_stop ? TWIM_FLAG_SEND_STOP : 0,
+	};
+
+	if (!TWI_MasterSubmit(&transaction)) return false;
+
+	uint8_t result = TWI_MasterWait(&transaction);
+
+	uint8_t ret = 0;
+	if (bytes_to_read > 0) {
+		// return bytes really read
+		ret = transaction.bytes_read;
 	} else {
-		return 1;
+		// return 0 if success, >0 otherwise (follow classic AVR conventions)
+		switch (result) {
+			case TWIM_RESULT_OK:
+				ret = 0;
+				break;
+			case TWIM_RESULT_BUFFER_OVERFLOW:
+				ret = 1;
+				break;
+			case TWIM_RESULT_NACK_RECEIVED:
+				ret = 3;
+				break;
+			default:
+				ret = 4;
+				break;
+		}
 	}
+
+	return ret;
 }
 
 
@@ -378,8 +533,13 @@ void TWI_MasterInterruptHandler()
 {
 	uint8_t currentStatus = TWI0.MSTATUS;
 
+	/* Spurious interrupt without a transaction in progress. */
+	if (master_queueHead == 0) {
+		TWI0.MSTATUS = currentStatus;
+	}
+
 	/* If arbitration lost or bus error. */
-	if ((currentStatus & TWI_ARBLOST_bm) ||
+	else if ((currentStatus & TWI_ARBLOST_bm) ||
 	    (currentStatus & TWI_BUSERR_bm)) {
 
 		TWI_MasterArbitrationLostBusErrorHandler();
@@ -410,21 +570,39 @@ void TWI_MasterArbitrationLostBusErrorHandler()
 {
 	uint8_t currentStatus = TWI0.MSTATUS;
 
+	/* Clear all flags, abort operation */
+	TWI0.MSTATUS = currentStatus;
+
 	/* If bus error. */
 	if (currentStatus & TWI_BUSERR_bm) {
-		master_result = TWIM_RESULT_BUS_ERROR;
+		TWI_COUNT_ERROR(bus_errors);
+		TWI_MasterTransactionFinished(TWIM_RESULT_BUS_ERROR);
 	}
-	/* If arbitration lost. */
+	/* If arbitration lost, retry sending as soon as the bus is idle again. */
 	else {
-		master_result = TWIM_RESULT_ARBITRATION_LOST;
+		TWI_MasterStartTransaction(master_queueHead);
 	}
+}
 
-	/* Clear all flags, abort operation */
-	TWI0.MSTATUS = currentStatus;
 
-	/* Wait for a new operation */	
-	twi_mode = TWI_MODE_MASTER;
-	master_trans_status = TWIM_STATUS_READY;
+/*! \brief End the bus activity of the current transaction.
+ *
+ *  If another transaction is queued, the bus is kept and the next one
+ *  continues with a repeated START (issued by the MADDR write in
+ *  TWI_MasterStartTransaction). Otherwise STOP is sent if requested.
+ *
+ *  \param ack_action  TWI_ACKACT_bm to NACK the last received byte, 0 otherwise.
+ */
+static void TWI_MasterEndTransfer(uint8_t ack_action)
+{
+	if (master_queueHead->next) {
+		TWI0.MCTRLB = ack_action;
+	} else if (master_queueHead->flags & TWIM_FLAG_SEND_STOP) {
+		TWI0.MCTRLB = ack_action | TWI_MCMD_STOP_gc;
+	} else {
+		/* Hold the bus, the next transaction starts with a repeated START */
+		TWI0.MCTRLB = ack_action;
+	}
 }
 
 
@@ -435,44 +613,34 @@ void TWI_MasterArbitrationLostBusErrorHandler()
  */
 void TWI_MasterWriteHandler()
 {
-	/* Local variables used in if tests to avoid compiler warning. */
-	uint8_t bytesToWrite  = master_bytesToWrite;
-	uint8_t bytesToRead   = master_bytesToRead;
+	TWI_TRANSACTION_t* transaction = master_queueHead;
 
 	/* If NOT acknowledged (NACK) by slave cancel the transaction. */
 	if (TWI0.MSTATUS & TWI_RXACK_bm) {
-		if(master_sendStop){
-			TWI0.MCTRLB = TWI_MCMD_STOP_gc;
-		} else {
-			TWI0.MCTRLB = TWI_MCMD_REPSTART_gc;
-
-		}
+		TWI_COUNT_ERROR(nacks);
+		TWI_MasterEndTransfer(0);
 		TWI_MasterTransactionFinished(TWIM_RESULT_NACK_RECEIVED);
 	}
 
 	/* If more bytes to write, send data. */
-	else if (master_bytesWritten < bytesToWrite) {
-		uint8_t data = master_writeData[master_bytesWritten];
+	else if (master_bytesWritten < transaction->bytes_to_write) {
+		uint8_t data = transaction->write_data[master_bytesWritten];
 		TWI0.MDATA = data;
 		master_bytesWritten++;
 	}
 
-	/* If bytes to read, send START condition + Address +
+	/* If bytes to read, send repeated START condition + Address +
 	 * 'R/_W = 1'
 	 */
-	else if (master_bytesRead < bytesToRead) {
+	else if (master_bytesRead < transaction->bytes_to_read) {
 		twi_mode = TWI_MODE_MASTER_RECEIVE;
-		uint8_t readAddress = ADD_READ_BIT(master_slaveAddress);
+		uint8_t readAddress = ADD_READ_BIT(transaction->slave_address << 1);
 		TWI0.MADDR = readAddress;
 	}
 
-	/* If transaction finished, send ACK/STOP condition if instructed and set RESULT OK. */
+	/* If transaction finished, send STOP condition if instructed and set RESULT OK. */
 	else {
-		if(master_sendStop){
-			TWI0.MCTRLB = TWI_MCMD_STOP_gc;
-		} else {
-			TWI0.MCTRLB = TWI_MCMD_REPSTART_gc;
-		}
+		TWI_MasterEndTransfer(0);
 		TWI_MasterTransactionFinished(TWIM_RESULT_OK);
 	}
 }
@@ -483,46 +651,33 @@ void TWI_MasterWriteHandler()
  *  This is the master read interrupt handler that takes care of
  *  reading bytes from the TWI slave.
  *
- *  \param twi The TWI_Master_t struct instance.
  */
 void TWI_MasterReadHandler()
 {
+	TWI_TRANSACTION_t* transaction = master_queueHead;
+
 	/* Fetch data if bytes to be read. */
-	if (master_bytesRead < master_bytesToRead) {
+	if (master_bytesRead < transaction->bytes_to_read) {
 		uint8_t data = TWI0.MDATA;
-		master_readData[master_bytesRead] = data;
+		transaction->read_data[master_bytesRead] = data;
 		master_bytesRead++;
 	}
 
 	/* If buffer overflow, issue NACK/STOP and BUFFER_OVERFLOW condition. */
 	else {
-		if(master_sendStop){
-			TWI0.MCTRLB = TWI_ACKACT_bm | TWI_MCMD_STOP_gc;
-		} else {
-			TWI0.MCTRLB = TWI_ACKACT_bm | TWI_MCMD_REPSTART_gc;
-		}
-		
+		TWI_MasterEndTransfer(TWI_ACKACT_bm);
 		TWI_MasterTransactionFinished(TWIM_RESULT_BUFFER_OVERFLOW);
-		master_bytesToRead = 0;
 		return;
 	}
 
-	/* Local variable used in if test to avoid compiler warning. */
-	uint8_t bytesToRead = master_bytesToRead;
-
 	/* If more bytes to read, issue ACK and start a byte read. */
-	if (master_bytesRead < bytesToRead) {
+	if (master_bytesRead < transaction->bytes_to_read) {
 		TWI0.MCTRLB = TWI_MCMD_RECVTRANS_gc;
 	}
 
 	/* If transaction finished, issue NACK and STOP condition if instructed. */
 	else {
-		if(master_sendStop){
-			TWI0.MCTRLB = TWI_ACKACT_bm | TWI_MCMD_STOP_gc;
-		} else {
-			TWI0.MCTRLB = TWI_ACKACT_bm | TWI_MCMD_REPSTART_gc;
-		}
-		
+		TWI_MasterEndTransfer(TWI_ACKACT_bm);
 		TWI_MasterTransactionFinished(TWIM_RESULT_OK);
 	}
 }
@@ -530,262 +685,35 @@ void TWI_MasterReadHandler()
 
 /*! \brief TWI transaction finished handler.
  *
- *  Prepares module for new transaction.
+ *  Signals completion of the current transaction and starts the next
+ *  queued one (if any).
  *
  *  \param result  The result of the operation.
  */
 void TWI_MasterTransactionFinished(uint8_t result)
 {
-	master_result = result;
-	master_trans_status = TWIM_STATUS_READY;
-	twi_mode = TWI_MODE_MASTER;
-}
+	TWI_TRANSACTION_t* finished = master_queueHead;
+	uint8_t bytesRead = master_bytesRead;
 
-
-/*! \brief Common TWI slave interrupt service routine.
- *
- *  Check current status and calls the appropriate handler.
- *
- */
-void TWI_SlaveInterruptHandler(){
-	uint8_t currentStatus = TWI0.SSTATUS;
-	
-	/* If bus error */
-	if(currentStatus & TWI_BUSERR_bm){
-		slave_bytesRead = 0;
-		slave_bytesWritten = 0;
-		slave_bytesToWrite = 0;
-		TWI_SlaveTransactionFinished(TWIS_RESULT_BUS_ERROR);
-	}
-	
-	/* If Address or Stop */
-	else if(currentStatus & TWI_APIF_bm){
-		
-		/* Call user onReceive function if end of Master Write/Slave Read.
-		 * This should be hit when there is a STOP or REPSTART 
-		 */
-		if(slave_callUserReceive == 1){
-			TWI_onSlaveReceive(slave_bytesRead);
-			slave_callUserReceive = 0;
-		}
-		
-		/* If address match */
-		if(currentStatus & TWI_AP_bm){
-			TWI_SlaveAddressMatchHandler();	
-		}
-		
-		/* If stop */
-		else {
-			TWI_SlaveStopHandler();
-			
-			/* If CLKHOLD is high, we have missed an address match 
-			  from a fast start after stop. 
-			  Because the flag is shared we need to handle this here.
-			*/
-			if(TWI0.SSTATUS & TWI_CLKHOLD_bm){
-				
-				/* CLKHOLD will be cleared by servicing the address match */
-				TWI_SlaveAddressMatchHandler();
-			}
-		}
-	}
-	
-	/* If Data Interrupt */
-	else if (currentStatus & TWI_DIF_bm){
-		
-		/* If collision flag is raised, slave transmit unsuccessful */
-		if (currentStatus & TWI_COLL_bm){
-			slave_bytesRead = 0;
-			slave_bytesWritten = 0;
-			slave_bytesToWrite = 0;
-			TWI_SlaveTransactionFinished(TWIS_RESULT_TRANSMIT_COLLISION);
-		} 
-		
-		/* Otherwise, normal data interrupt */
-		else {
-			TWI_SlaveDataHandler();
-		}
+	master_queueHead = finished->next;
+	if (master_queueHead == 0) {
+		master_queueTail = 0;
 	}
-	
-	/* If unexpected state */
-	else {
-		TWI_SlaveTransactionFinished(TWIS_RESULT_FAIL);
-	}
-}
-
-/*! \brief TWI slave address interrupt handler.
- *
- *  This is the slave address match handler that takes care of responding to
- *  being addressed by a master
- *
- */
-void TWI_SlaveAddressMatchHandler(){
-	slave_trans_status = TWIS_STATUS_BUSY;
-	slave_result = TWIS_RESULT_UNKNOWN;
-	
-	/* Send ACK, wait for data interrupt */
-	TWI0.SCTRLB = TWI_SCMD_RESPONSE_gc;	
-	
-	/* If Master Read/Slave Write */
-	if(TWI0.SSTATUS & TWI_DIR_bm){
-		slave_bytesWritten = 0;
-		/* Call user function  */
-		slave_bytesToWrite = TWI_onSlaveTransmit();	
-		twi_mode = TWI_MODE_SLAVE_TRANSMIT;
-	} 
-	/* If Master Write/Slave Read */
-	else {
-		slave_bytesRead = 0;
-		slave_callUserReceive = 1;
-		twi_mode = TWI_MODE_SLAVE_RECEIVE;
-	}
-	
-	/* Data interrupt to follow... */
-}
-
-/*! \brief TWI slave stop interrupt handler.
- *
- */
-void TWI_SlaveStopHandler(){
-	
-	/* Clear APIF, don't ACK or NACK */
-	TWI0.SSTATUS = TWI_APIF_bm;
-	
-	TWI_SlaveTransactionFinished(TWIS_RESULT_OK);
-	
-}
-
-/*! \brief TWI slave data interrupt handler.
- *
- *  This is the slave data handler that takes care of sending data to or 
- *  receiving data from a master
- *
- */
-void TWI_SlaveDataHandler(){
-	
-	/* Enable stop interrupt */
-	TWI0.SCTRLA |= (TWI_APIEN_bm | TWI_PIEN_bm);	
-	
-	/* If Master Read/Slave Write */
-	if(TWI0.SSTATUS & TWI_DIR_bm){
-		
-		TWI_SlaveWriteHandler();
-	}
-	 
-	/* If Master Write/Slave Read */
-	else {
-		TWI_SlaveReadHandler();
-	}	
-	
-
-}
-
-/*! \brief TWI slave data write interrupt handler.
- *
- *  This is the slave data handler that takes care of sending data to a master
- *
- */
-void TWI_SlaveWriteHandler(){
-	
-	/* If NACK, slave write transaction finished */
-	if((slave_bytesWritten > 0) && (TWI0.SSTATUS & TWI_RXACK_bm)){
+	twi_mode = TWI_MODE_MASTER;
 
-		TWI0.SCTRLB = TWI_SCMD_COMPTRANS_gc;
-		TWI_SlaveTransactionFinished(TWIS_RESULT_OK);
+	/* Start chained transaction before signalling, the callback may queue more */
+	if (master_queueHead) {
+		TWI_MasterStartTransaction(master_queueHead);
 	}
-	
-	/* If ACK, master expects more data */
-	else {		
-
-		if(slave_bytesWritten < slave_bytesToWrite){
-			uint8_t data = slave_writeData[slave_bytesWritten];
-			TWI0.SDATA = data;
-			slave_bytesWritten++;	
-			
-			/* Send data, wait for data interrupt */
-			TWI0.SCTRLB = TWI_SCMD_RESPONSE_gc;
-			
-		} 
-		
-		/* If buffer overflow */
-		else {
-			TWI0.SCTRLB = TWI_SCMD_COMPTRANS_gc;
-			TWI_SlaveTransactionFinished(TWIS_RESULT_BUFFER_OVERFLOW);
-			
-		}
-		
-			
-	}	
-}
 
-/*! \brief TWI slave data read interrupt handler.
- *
- *  This is the slave data handler that takes care of receiving data from a master
- *
- */
-void TWI_SlaveReadHandler(){
-		
-	/* If free space in buffer */
-	if(slave_bytesRead < slave_bytesToRead){
-		
-		/* Fetch data */
-		uint8_t data = TWI0.SDATA;
-		slave_readData[slave_bytesRead] = data;
-		slave_bytesRead++;
-		
-		/* Send ACK and wait for data interrupt */
-		TWI0.SCTRLB = TWI_SCMD_RESPONSE_gc;		
+	finished->bytes_read = bytesRead;
+	finished->result = result;
+	if (finished->on_complete) {
+		finished->on_complete(finished);
 	}
-	/* If buffer overflow, send NACK and wait for next START. 
-		Set result buffer overflow */
-	else {
-		TWI0.SCTRLB = TWI_ACKACT_bm | TWI_SCMD_COMPTRANS_gc;
-		TWI_SlaveTransactionFinished(TWIS_RESULT_BUFFER_OVERFLOW);
-	}	
-}
-
-/* 
- * Function twi_attachSlaveRxEvent
- * Desc     sets function called before a slave read operation
- * Input    function: callback function to use
- * Output   none
- */
-void TWI_attachSlaveRxEvent( void (*function)(int), uint8_t *read_data, uint8_t bytes_to_read ){
-  TWI_onSlaveReceive = function;
-  slave_readData = read_data;
-  slave_bytesToRead = bytes_to_read;
-}
-
-/* 
- * Function twi_attachSlaveTxEvent
- * Desc     sets function called before a slave write operation
- * Input    function: callback function to use
- * Output   none
- */
-void TWI_attachSlaveTxEvent( uint8_t (*function)(void), uint8_t* write_data ){
-  TWI_onSlaveTransmit = function;
-  slave_writeData = write_data;
 }
 
 
-/*! \brief TWI slave transaction finished handler.
- *
- *  Prepares module for new transaction.
- *
- *  \param result  The result of the operation.
- */
-void TWI_SlaveTransactionFinished(uint8_t result)
-{
-	TWI0.SCTRLA |= (TWI_APIEN_bm | TWI_PIEN_bm);
-	twi_mode = TWI_MODE_SLAVE;
-	slave_result = result;
-	slave_trans_status = TWIM_STATUS_READY;
-}
-
 ISR(TWI0_TWIM_vect){
 	TWI_MasterInterruptHandler();
-}
-
-ISR(TWI0_TWIS_vect){
-	TWI_SlaveInterruptHandler();
 }
\ No newline at end of file
@@ -27,6 +27,41 @@
 
 #define TWIM_SEND_STOP					1
 
+/*! Transaction timeout.
+ *  Requires TWI_TIMESTAMP() returning a free-running 16 bit tick counter
+ *  with TWI_TIMESTAMP_HZ ticks per second (see deviceconfig.h).
+ *  Without it, transactions wait forever.
+ */
+#ifndef TWI_TIMEOUT_MS
+#  define TWI_TIMEOUT_MS				20
+#endif
+#ifdef TWI_TIMESTAMP
+#  define TWI_TIMEOUT_TICKS				((uint16_t)(((TWI_TIMEOUT_MS) * (TWI_TIMESTAMP_HZ) + 999UL) / 1000UL))
+#endif
+
+/*! Idle sleep while waiting.
+ *  With TWI_IDLE_SLEEP defined, TWI_MasterWait() puts the CPU into IDLE sleep
+ *  between TWI interrupts instead of spinning. Combined with a timeout, a
+ *  wake-up source is needed in case the bus hangs and no TWI interrupt comes:
+ *  TWI_WAKEUP_ARM(timestamp) must schedule an interrupt at the given
+ *  TWI_TIMESTAMP() value and evaluate to non-zero, or evaluate to zero if it
+ *  cannot be armed right now (the wait then spins for that round).
+ *  TWI_WAKEUP_DISARM() cancels it again.
+ *  A new wake-up time may need a few ticks to take effect (e.g. the RTC
+ *  synchronises CMP for up to 2 cycles). If the counter passes it in the
+ *  meantime, the interrupt is missed, so the wait spins instead of sleeping
+ *  once the timeout is no more than TWI_WAKEUP_MARGIN_TICKS ahead.
+ */
+#if defined(TWI_IDLE_SLEEP) && defined(TWI_TIMESTAMP) && !defined(TWI_WAKEUP_ARM)
+#  error "TWI_IDLE_SLEEP with TWI_TIMESTAMP requires TWI_WAKEUP_ARM() and TWI_WAKEUP_DISARM()"
+#endif
+#ifndef TWI_WAKEUP_MARGIN_TICKS
+#  define TWI_WAKEUP_MARGIN_TICKS		2
+#endif
+
+/*! Transaction descriptor flags. */
+#define TWIM_FLAG_SEND_STOP				(1<<0)	/*!< Release the bus with STOP unless another transaction is chained */
+
 /*! Transaction status defines. */
 #define TWIM_STATUS_READY				0
 #define TWIM_STATUS_BUSY				1
@@ -44,6 +79,7 @@ typedef enum TWIM_RESULT_enum {
 	TWIM_RESULT_BUS_ERROR        = (0x04<<0),
 	TWIM_RESULT_NACK_RECEIVED    = (0x05<<0),
 	TWIM_RESULT_FAIL             = (0x06<<0),
+	TWIM_RESULT_TIMEOUT          = (0x07<<0),
 } TWIM_RESULT_t;
 
 /* Transaction result enumeration */
@@ -57,6 +93,35 @@ typedef enum TWIS_RESULT_enum {
 	TWIS_RESULT_ABORTED            = (0x06<<0),
 } TWIS_RESULT_t;
 
+/*! \brief Master transaction descriptor.
+ *
+ *  Caller-owned descriptor for queued master transactions. The driver works
+ *  directly on the referenced buffers (no copies), so descriptor and buffers
+ *  must stay valid until \ref result is no longer TWIM_RESULT_UNKNOWN.
+ *  A write followed by a read is executed with a repeated START in between.
+ *  Transactions queued back-to-back are chained with a repeated START as well.
+ */
+typedef struct TWI_TRANSACTION_struct {
+	struct TWI_TRANSACTION_struct* volatile next;	/*!< Queue link, managed by the driver */
+	void (*on_complete)(struct TWI_TRANSACTION_struct* transaction);	/*!< Optional, called with interrupts disabled (ISR or TWI_MasterAbort()) */
+	uint8_t  slave_address;							/*!< 7-bit slave address */
+	uint8_t* write_data;							/*!< Data to write */
+	uint8_t  bytes_to_write;						/*!< Number of bytes to write */
+	uint8_t* read_data;								/*!< Buffer for read data */
+	uint8_t  bytes_to_read;							/*!< Number of bytes to read */
+	uint8_t  flags;									/*!< TWIM_FLAG_xxx */
+	volatile uint8_t bytes_read;					/*!< Number of bytes actually read */
+	volatile uint8_t result;						/*!< TWIM_RESULT_t, TWIM_RESULT_UNKNOWN while pending */
+} TWI_TRANSACTION_t;
+
+/*! Master error counters (saturating). */
+typedef struct TWIM_ERRORS_struct {
+	uint8_t timeouts;			/*!< Transactions aborted by timeout */
+	uint8_t bus_errors;			/*!< Bus errors detected by hardware */
+	uint8_t nacks;				/*!< NACK received on address or data */
+	uint8_t recoveries;			/*!< Bus recovery sequences issued */
+} TWIM_ERRORS_t;
+
 /*! TWI Modes */
 typedef enum TWI_MODE_enum {
 	TWI_MODE_UNKNOWN = 0,
@@ -68,12 +133,99 @@ typedef enum TWI_MODE_enum {
 	TWI_MODE_SLAVE_RECEIVE = 6
 } TWI_MODE_t;
 
+/*! \brief Compile-time SCL clock plan.
+ *
+ *  Computes MBAUD for the CPU clock used during TWI operation (F_CPU_TWI) and
+ *  selects the fastest I2C mode whose timing can be met:
+ *
+ *    fSCL = fCLK / (10 + 2 * BAUD + fCLK * tR)       (datasheet, TWI baud rate)
+ *    tLOW = (BAUD + 5) / fCLK - tOF  >=  tLOW(min)
+ *
+ *  F_SCL limits the result to what the slaves support. Define TWI_T_RISE [ns]
+ *  with the measured bus rise time, otherwise the maximum of each mode is
+ *  assumed. Define TWI_FMPLUS_AVAILABLE if the bus may run in Fast-mode Plus.
+ *  Evaluated by the preprocessor only (no runtime arithmetic), so the result
+ *  can also be checked with #if. Define OVERRIDE_TWI_BAUD together with
+ *  TWI_BAUD_VALUE to bypass the calculation.
+ */
+#ifndef F_CPU_TWI
+#  define F_CPU_TWI					F_CPU
+#endif
+
+#ifndef F_SCL
+#  define F_SCL						100000UL
+#endif
+
+// See Datasheet / Electrical Characteristics. F values in Hertz, T values in nanoseconds
+#define TWI_SM_F_SCL				100000UL
+#define TWI_SM_T_RISE				1000UL
+#define TWI_SM_T_LOW_MIN			4700UL
+#define TWI_SM_T_OF					250UL
+
+#define TWI_FM_F_SCL				400000UL
+#define TWI_FM_T_RISE				300UL
+#define TWI_FM_T_LOW_MIN			1300UL
+#define TWI_FM_T_OF					250UL
+
+#define TWI_FMP_F_SCL				1000000UL
+#define TWI_FMP_T_RISE				120UL
+#define TWI_FMP_T_LOW_MIN			500UL
+#define TWI_FMP_T_OF				120UL
+
+#ifdef TWI_T_RISE
+#  define TWI_BUS_T_RISE(_mode_)	(TWI_T_RISE)
+#else
+#  define TWI_BUS_T_RISE(_mode_)	(TWI_##_mode_##_T_RISE)
+#endif
+
+/* Number of CPU cycles covering _t_ nanoseconds (rounded up) */
+#define TWI_CYCLES(_t_)				((((F_CPU_TWI) / 1000UL) * (_t_) + 999999UL) / 1000000UL)
+#define TWI_DIV_CEIL(_a_, _b_)		(((_a_) + (_b_) - 1) / (_b_))
+#define TWI_MAX(_a_, _b_)			((_a_) > (_b_) ? (_a_) : (_b_))
+
+/* Smallest BAUD not exceeding the mode's SCL frequency */
+#define TWI_BAUD_F_SCL(_mode_) \
+	((TWI_DIV_CEIL((F_CPU_TWI), TWI_##_mode_##_F_SCL) > (10 + TWI_CYCLES(TWI_BUS_T_RISE(_mode_)))) \
+		? ((TWI_DIV_CEIL((F_CPU_TWI), TWI_##_mode_##_F_SCL) - 10 - TWI_CYCLES(TWI_BUS_T_RISE(_mode_)) + 1) / 2) \
+		: 0)
+/* Smallest BAUD satisfying the mode's minimum SCL low time */
+#define TWI_BAUD_T_LOW(_mode_) \
+	((TWI_CYCLES(TWI_##_mode_##_T_LOW_MIN + TWI_##_mode_##_T_OF) > 5) \
+		? (TWI_CYCLES(TWI_##_mode_##_T_LOW_MIN + TWI_##_mode_##_T_OF) - 5) \
+		: 0)
+#define TWI_MODE_BAUD(_mode_)		TWI_MAX(TWI_BAUD_F_SCL(_mode_), TWI_BAUD_T_LOW(_mode_))
+/* Resulting SCL frequency of a mode (rounded down) */
+#define TWI_MODE_F_SCL(_mode_)		((F_CPU_TWI) / (10 + 2 * TWI_MODE_BAUD(_mode_) + TWI_CYCLES(TWI_BUS_T_RISE(_mode_))))
+
+/* A faster mode is only legal if the bus meets its rise time and the result
+ * actually exceeds the slower mode, otherwise the slower mode timing applies */
+#define TWI_MODE_LEGAL(_mode_, _slower_) \
+	(((F_SCL) >= TWI_##_mode_##_F_SCL) && \
+	 (TWI_BUS_T_RISE(_mode_) <= TWI_##_mode_##_T_RISE) && \
+	 (TWI_MODE_F_SCL(_mode_) > TWI_##_slower_##_F_SCL))
+
+#ifndef OVERRIDE_TWI_BAUD
+#  if defined(TWI_FMPLUS_AVAILABLE) && TWI_MODE_LEGAL(FMP, FM)
+#    define TWI_FAST_MODE_PLUS
+#    define TWI_BAUD_VALUE			TWI_MODE_BAUD(FMP)
+#    define TWI_F_SCL_ACTUAL		TWI_MODE_F_SCL(FMP)
+#  elif TWI_MODE_LEGAL(FM, SM)
+#    define TWI_BAUD_VALUE			TWI_MODE_BAUD(FM)
+#    define TWI_F_SCL_ACTUAL		TWI_MODE_F_SCL(FM)
+#  else
+#    define TWI_BAUD_VALUE			TWI_MODE_BAUD(SM)
+#    define TWI_F_SCL_ACTUAL		TWI_MODE_F_SCL(SM)
+#  endif
+#  if (TWI_BAUD_VALUE) > 255
+#    error "TWI baud value out of range, reduce F_CPU_TWI!"
+#  endif
+#endif
+
 /*! For adding R/_W bit to address */
 #define ADD_READ_BIT(address)	(address | 0x01)
 #define ADD_WRITE_BIT(address)  (address & ~0x01)
 
 void TWI_MasterInit(void);
-void TWI_SlaveInit(uint8_t address);
 void TWI_Flush(void);
 void TWI_Disable(void);
 TWI_BUSSTATE_t TWI_MasterState(void);
@@ -90,14 +242,23 @@ uint8_t TWI_MasterRead(uint8_t slave_address,
 uint8_t TWI_MasterWriteRead(uint8_t slave_address,
                          uint8_t *write_data,
                          uint8_t bytes_to_write,
+                         uint8_t *read_data,
                          uint8_t bytes_to_read,
 						 uint8_t send_stop);
+uint8_t TWI_MasterSubmit(TWI_TRANSACTION_t* transaction);
+uint8_t TWI_MasterWait(TWI_TRANSACTION_t* transaction);
+void TWI_MasterAbort(uint8_t result);
+void TWI_MasterRecoverBus(void);
+const TWIM_ERRORS_t* TWI_MasterErrors(void);
+void TWI_MasterClearErrors(void);
 void TWI_MasterInterruptHandler(void);
 void TWI_MasterArbitrationLostBusErrorHandler(void);
 void TWI_MasterWriteHandler(void);
 void TWI_MasterReadHandler(void);
 void TWI_MasterTransactionFinished(uint8_t result);
 
+#ifdef TWI_ENABLE_SLAVE
+void TWI_SlaveInit(uint8_t address);
 void TWI_SlaveInterruptHandler(void);
 void TWI_SlaveAddressMatchHandler(void);
 void TWI_SlaveStopHandler(void);
@@ -107,6 +268,8 @@ void TWI_SlaveReadHandler(void);
 void TWI_attachSlaveRxEvent( void (*function)(int), uint8_t *read_data, uint8_t bytes_to_read );
 void TWI_attachSlaveTxEvent( uint8_t (*function)(void), uint8_t *write_data );
 void TWI_SlaveTransactionFinished(uint8_t result);
+#endif /* TWI_ENABLE_SLAVE */
+
 /*! TWI master interrupt service routine.
  *
  *  Interrupt service routine for the TWI master. Copy the needed vectors
@@ -122,6 +285,8 @@ void TWI_SlaveTransactionFinished(uint8_t result);
 		TWI_SlaveInterruptHandler();
 	}	
 
+ *  Both are provided by twi.c / twi_slave.c. The slave part (including
+ *  its vector) is only built if TWI_ENABLE_SLAVE is defined.
  *
  */ 
 